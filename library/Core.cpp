@@ -35,6 +35,10 @@ distribution.
 #include <forward_list>
 #include <type_traits>
 #include <cstdarg>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <numeric>
 using namespace std;
 
 #include "Error.h"
@@ -81,6 +85,7 @@ using namespace DFHack;
 #include <fstream>
 #include <thread>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 #include "md5wrapper.h"
 
@@ -88,6 +93,10 @@ using namespace DFHack;
 
 #ifdef LINUX_BUILD
 #include <dlfcn.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
 #endif
 
 using namespace df::enums;
@@ -558,15 +567,207 @@ void Core::getScriptPaths(std::vector<std::string> *dest)
 }
 
 
+/*
+ * Index of the files in script directories, so that resolving a command
+ * name is a hash lookup instead of a stat() per search path entry.
+ * Directories are listed on first use and re-listed when inotify reports
+ * a change, or (where inotify is unavailable) when their mtime changes.
+ * Polled directories can be briefly out of date and may live on a case
+ * insensitive filesystem, so a miss in one of them is checked with a stat.
+ */
+namespace {
+    class ScriptIndex {
+        struct DirEntry {
+            std::unordered_set<string> files;
+            int64_t mtime;
+            int watch;
+            time_t checked;
+        };
+
+        std::mutex lock;
+        std::unordered_map<string, DirEntry> dirs;
+#ifdef __linux__
+        int notify_fd;
+        std::unordered_map<int, string> watches;
+#endif
+
+        static const int POLL_INTERVAL = 1; // seconds
+
+        void processEvents();
+        DirEntry *getDir(const string &dir);
+        void scan(const string &dir, DirEntry &entry);
+
+    public:
+        ScriptIndex();
+        ~ScriptIndex();
+
+        bool hasFile(const string &dir, const string &name);
+        void listFiles(const string &dir, std::vector<string> &files);
+    };
+
+    ScriptIndex script_index;
+}
+
+ScriptIndex::ScriptIndex()
+{
+#ifdef __linux__
+    notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+ScriptIndex::~ScriptIndex()
+{
+#ifdef __linux__
+    if (notify_fd >= 0)
+        close(notify_fd);
+#endif
+}
+
+void ScriptIndex::processEvents()
+{
+#ifdef __linux__
+    if (notify_fd < 0)
+        return;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(notify_fd, buf, sizeof(buf))) > 0)
+    {
+        for (char *ptr = buf; ptr < buf + len; )
+        {
+            auto event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were lost, so any directory may be out of date
+                for (auto &dir : dirs)
+                    dir.second.checked = 0;
+                continue;
+            }
+
+            auto it = watches.find(event->wd);
+            if (it == watches.end())
+                continue;
+
+            if (event->mask & (IN_IGNORED | IN_MOVE_SELF))
+            {
+                // The directory itself went away; forget it entirely
+                if (event->mask & IN_MOVE_SELF)
+                    inotify_rm_watch(notify_fd, event->wd);
+                dirs.erase(it->second);
+                watches.erase(it);
+            }
+            else
+            {
+                auto dir = dirs.find(it->second);
+                if (dir != dirs.end())
+                    dir->second.checked = 0;
+            }
+        }
+    }
+#endif
+}
+
+void ScriptIndex::scan(const string &dir, DirEntry &entry)
+{
+    entry.files.clear();
+    entry.mtime = Filesystem::mtime(dir);
+
+    std::vector<string> names;
+    if (entry.mtime >= 0 && Filesystem::listdir(dir, names) == 0)
+    {
+        for (auto &name : names)
+        {
+            if (Filesystem::isfile(dir + "/" + name))
+                entry.files.insert(name);
+        }
+    }
+}
+
+ScriptIndex::DirEntry *ScriptIndex::getDir(const string &dir)
+{
+    time_t now = time(NULL);
+
+    auto it = dirs.find(dir);
+    if (it == dirs.end())
+    {
+        // Only existing directories are indexed, so that looking up names in
+        // made-up subdirectories doesn't grow the index
+        if (!Filesystem::isdir(dir))
+            return NULL;
+
+        DirEntry &entry = dirs[dir];
+        entry.watch = -1;
+#ifdef __linux__
+        if (notify_fd >= 0)
+        {
+            entry.watch = inotify_add_watch(notify_fd, dir.c_str(),
+                IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+            if (entry.watch >= 0)
+                watches[entry.watch] = dir;
+        }
+#endif
+        scan(dir, entry);
+        entry.checked = now;
+        return &entry;
+    }
+
+    DirEntry &entry = it->second;
+    if (entry.checked == 0)
+    {
+        // invalidated by a change notification
+        scan(dir, entry);
+        entry.checked = now;
+    }
+    else if (entry.watch < 0 && now - entry.checked >= POLL_INTERVAL)
+    {
+        if (Filesystem::mtime(dir) != entry.mtime)
+            scan(dir, entry);
+        entry.checked = now;
+    }
+    return &entry;
+}
+
+bool ScriptIndex::hasFile(const string &dir, const string &name)
+{
+    // Names may include subdirectories, e.g. "gui/gm-editor.lua"
+    string subdir = dir, file = name;
+    size_t slash = name.find_last_of('/');
+    if (slash != string::npos)
+    {
+        subdir += "/" + name.substr(0, slash);
+        file = name.substr(slash + 1);
+    }
+
+    lock_guard<mutex> guard(lock);
+    processEvents();
+    auto entry = getDir(subdir);
+    if (!entry)
+        return false;
+    if (entry->files.count(file))
+        return true;
+    return entry->watch < 0 && Filesystem::isfile(subdir + "/" + file);
+}
+
+void ScriptIndex::listFiles(const string &dir, std::vector<string> &files)
+{
+    lock_guard<mutex> guard(lock);
+    processEvents();
+    auto entry = getDir(dir);
+    if (entry)
+        files.insert(files.end(), entry->files.begin(), entry->files.end());
+}
+
 string Core::findScript(string name)
 {
     vector<string> paths;
     getScriptPaths(&paths);
     for (auto it = paths.begin(); it != paths.end(); ++it)
     {
-        string path = *it + "/" + name;
-        if (Filesystem::isfile(path))
-            return path;
+        if (script_index.hasFile(*it, name))
+            return *it + "/" + name;
     }
     return "";
 }
@@ -850,6 +1051,8 @@ command_result Core::runCommand(color_ostream &con, const std::string &first_, v
                     }
 
                     Plugin * plug = (*plug_mgr)[part];
+                    if (plug)
+                        plug->load_if_deferred(con);
 
                     if(!plug)
                     {
@@ -1425,7 +1628,119 @@ bool Core::loadScriptFile(color_ostream &out, string fname, bool silent)
     return true;
 }
 
+/*
+ * Startup phase timing. A summary of the phases of Core::Init is printed
+ * to stderr; if DFHACK_STARTUP_TRACE is set to a file name, the phases are
+ * also written there in Chrome trace-event format (chrome://tracing).
+ */
+namespace {
+    class StartupTrace {
+        typedef std::chrono::steady_clock clock;
+
+        struct Event {
+            std::string name;
+            int tid;
+            double start_us, dur_us;
+        };
+
+        std::mutex lock;
+        clock::time_point origin;
+        std::vector<Event> events;
+        // currently open phase, per thread id
+        std::map<int, std::pair<std::string, clock::time_point> > open;
+
+        double since_origin(clock::time_point t) {
+            return std::chrono::duration<double, std::micro>(t - origin).count();
+        }
+
+    public:
+        enum { MAIN_THREAD = 1, INIT_THREAD = 2 };
+
+        StartupTrace() : origin(clock::now()) {}
+
+        // Ends the current phase on the thread, and starts a new one if name is given
+        void phase(int tid, const char *name = NULL)
+        {
+            auto now = clock::now();
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = open.find(tid);
+            if (it != open.end())
+            {
+                Event ev;
+                ev.name = it->second.first;
+                ev.tid = tid;
+                ev.start_us = since_origin(it->second.second);
+                ev.dur_us = since_origin(now) - ev.start_us;
+                events.push_back(ev);
+                open.erase(it);
+            }
+            if (name)
+                open[tid] = std::make_pair(std::string(name), now);
+        }
+
+        std::string summary(int tid)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::stringstream out;
+            double total = 0;
+            out << std::fixed << std::setprecision(1);
+            for (auto &ev : events)
+            {
+                if (ev.tid != tid)
+                    continue;
+                out << (total ? ", " : "") << ev.name << " " << ev.dur_us / 1000 << " ms";
+                total += ev.dur_us;
+            }
+            out << " (total " << total / 1000 << " ms)";
+            return out.str();
+        }
+
+        void write()
+        {
+            const char *path = getenv("DFHACK_STARTUP_TRACE");
+            if (!path || !*path)
+                return;
+
+            std::lock_guard<std::mutex> guard(lock);
+            std::ofstream out(path);
+            if (!out)
+            {
+                std::cerr << "Could not write startup trace to " << path << std::endl;
+                return;
+            }
+
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << MAIN_THREAD
+                << ",\"args\":{\"name\":\"Core::Init\"}},\n";
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << INIT_THREAD
+                << ",\"args\":{\"name\":\"dfhack.init\"}}";
+            out << std::fixed << std::setprecision(3);
+            for (auto &ev : events)
+            {
+                out << ",\n{\"name\":\"" << ev.name << "\",\"cat\":\"startup\",\"ph\":\"X\""
+                    << ",\"ts\":" << ev.start_us << ",\"dur\":" << ev.dur_us
+                    << ",\"pid\":1,\"tid\":" << ev.tid << "}";
+            }
+            out << "\n]}\n";
+        }
+    };
+
+    StartupTrace startup_trace;
+}
+
+static void run_dfhack_init_scripts(color_ostream &out, Core *core);
+
 static void run_dfhack_init(color_ostream &out, Core *core)
+{
+    startup_trace.phase(StartupTrace::INIT_THREAD, "init scripts");
+    run_dfhack_init_scripts(out, core);
+    startup_trace.phase(StartupTrace::INIT_THREAD);
+
+    cerr << "DFHack init scripts: " << startup_trace.summary(StartupTrace::INIT_THREAD) << endl;
+    startup_trace.write();
+}
+
+static void run_dfhack_init_scripts(color_ostream &out, Core *core)
 {
     if (!df::global::world || !df::global::ui || !df::global::gview)
     {
@@ -1609,6 +1924,8 @@ bool Core::Init()
 
     fprintf(stderr, "DFHack build: %s\n", Version::git_description());
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "version detection");
+
     // find out what we are...
     #ifdef LINUX_BUILD
         const char * path = "hack/symbols.xml";
@@ -1632,6 +1949,27 @@ bool Core::Init()
     }
     vif = std::move(local_vif);
     auto local_p = dts::make_unique<DFHack::Process>(*vif);
+    if (!local_p->isIdentified() && vif->isFromCache())
+    {
+        // The executable changed since the cache was written; use the full xml
+        cerr << "Cached symbol table does not match, reloading.\n";
+        try
+        {
+            vif->loadFile(path, false);
+        }
+        catch(Error::All & err)
+        {
+            std::stringstream out;
+            out << "Error while reading symbols.xml:\n";
+            out << err.what() << std::endl;
+            errorstate = true;
+            fatal(out.str());
+            return false;
+        }
+        local_p = dts::make_unique<DFHack::Process>(*vif);
+    }
+    if (local_p->isIdentified())
+        vif->saveCache(*local_p->getDescriptor());
     local_p->ValidateDescriptionOS();
     vinfo = local_p->getDescriptor();
 
@@ -1671,6 +2009,8 @@ bool Core::Init()
     cerr << "Version: " << vinfo->getVersion() << endl;
     p = std::move(local_p);
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "console");
+
     // Init global object pointers
     df::global::InitGlobals();
 
@@ -1717,8 +2057,11 @@ bool Core::Init()
     }
     */
     // initialize data defs
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "data definitions");
     virtual_identity::Init(this);
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "config files");
+
     // copy over default config files if necessary
     std::vector<std::string> config_files;
     std::vector<std::string> default_config_files;
@@ -1754,6 +2097,7 @@ bool Core::Init()
     loadScriptPaths(con);
 
     // initialize common lua context
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "lua");
     if (!Lua::Core::Init(con))
     {
         fatal("Lua failed to initialize");
@@ -1761,6 +2105,7 @@ bool Core::Init()
     }
 
     // create mutex for syncing with interactive tasks
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "plugins");
     cerr << "Initializing Plugins.\n";
     // create plugin manager
     plug_mgr = new PluginManager(this);
@@ -1769,6 +2114,7 @@ bool Core::Init()
     temp->core = this;
     temp->plug_mgr = plug_mgr;
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "threads");
     if (!is_text_mode || is_headless)
     {
         cerr << "Starting IO thread.\n";
@@ -1789,11 +2135,13 @@ bool Core::Init()
     started = true;
     modstate = 0;
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "rpc server");
     cerr << "Starting the TCP listener.\n";
     server = new ServerMain();
     if (!server->listen(RemoteClient::GetDefaultPort()))
         cerr << "TCP listen failed.\n";
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD, "command line");
     if (df::global::ui_sidebar_menus)
     {
         vector<string> args;
@@ -1855,6 +2203,9 @@ bool Core::Init()
         }
     }
 
+    startup_trace.phase(StartupTrace::MAIN_THREAD);
+    cerr << "DFHack startup: " << startup_trace.summary(StartupTrace::MAIN_THREAD) << endl;
+
     cerr << "DFHack is running.\n";
     return true;
 }
@@ -1939,6 +2290,178 @@ int Core::TileUpdate()
     return true;
 }
 
+/*
+ * Per-frame timing of Core::Update. The last FrameStats::WINDOW frames are
+ * kept to compute percentiles (see Core::getFrameStats and the GetFrameStats
+ * RPC call). If DFHACK_FRAME_STATS_CSV is set to a file name, a row of
+ * percentiles is written there every WINDOW frames; the file holds the last
+ * CSV_ROWS rows, overwriting the oldest one in place.
+ */
+const char *const FrameStats::section_names[FrameStats::NUM_SECTIONS] = {
+    "state_checks", "event_manager", "buildings", "plugins",
+    "lua_timers", "tools", "total", "frame"
+};
+
+namespace {
+    class FrameTelemetry {
+        typedef std::chrono::steady_clock clock;
+        static const size_t WINDOW = FrameStats::WINDOW;
+        static const size_t CSV_ROWS = 1440;
+
+        std::mutex lock;
+        std::vector<float> samples[FrameStats::NUM_SECTIONS];
+        size_t next;
+        uint64_t frames;
+
+        // only used by the simulation thread
+        float current[FrameStats::NUM_SECTIONS];
+        clock::time_point mark, frame_start, last_frame_start;
+        bool started;
+        std::fstream csv;
+        bool csv_checked;
+        std::streamoff csv_header_len;
+        size_t csv_rows;
+
+        static float usec(clock::duration d) {
+            return std::chrono::duration<float, std::micro>(d).count();
+        }
+
+        void write_csv(const FrameStats &stats)
+        {
+            if (!csv_checked)
+            {
+                csv_checked = true;
+                const char *path = getenv("DFHACK_FRAME_STATS_CSV");
+                if (!path || !*path)
+                    return;
+                csv.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+                if (!csv)
+                {
+                    cerr << "Could not write frame stats to " << path << endl;
+                    return;
+                }
+                csv << "dfhack_version,time,frame";
+                for (auto name : FrameStats::section_names)
+                    csv << "," << name << "_p50," << name << "_p95,"
+                        << name << "_p99," << name << "_max";
+                csv << "\n";
+                csv_header_len = csv.tellp();
+            }
+            if (!csv.is_open())
+                return;
+
+            // all rows have the same width, so that the oldest can be overwritten
+            char buf[64];
+            std::string row;
+            snprintf(buf, sizeof(buf), "%-24.24s,%10lld,%12llu",
+                     Version::dfhack_version(), (long long)time(NULL),
+                     (unsigned long long)stats.total_frames);
+            row += buf;
+            for (auto &p : stats.section)
+            {
+                for (double v : {p.p50, p.p95, p.p99, p.max})
+                {
+                    snprintf(buf, sizeof(buf), ",%10.1f", std::min(v, 99999999.9));
+                    row += buf;
+                }
+            }
+            row += "\n";
+
+            csv.seekp(csv_header_len + std::streamoff((csv_rows++ % CSV_ROWS) * row.size()));
+            csv.write(row.data(), row.size());
+            csv.flush();
+        }
+
+    public:
+        FrameTelemetry() : next(0), frames(0), started(false),
+            csv_checked(false), csv_header_len(0), csv_rows(0)
+        {
+            for (auto &v : samples)
+                v.reserve(WINDOW);
+        }
+
+        void begin()
+        {
+            frame_start = mark = clock::now();
+            std::fill(std::begin(current), std::end(current), 0.0f);
+        }
+
+        // Charges the time since the previous mark to the section
+        void lap(FrameStats::Section section)
+        {
+            auto now = clock::now();
+            current[section] += usec(now - mark);
+            mark = now;
+        }
+
+        void end()
+        {
+            current[FrameStats::TOTAL] = usec(mark - frame_start);
+            current[FrameStats::FRAME] = usec(frame_start - last_frame_start);
+            last_frame_start = frame_start;
+            // the first frame also runs Core::Init, and has no previous frame
+            if (!started)
+            {
+                started = true;
+                return;
+            }
+
+            bool window_full;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (int i = 0; i < FrameStats::NUM_SECTIONS; i++)
+                {
+                    if (samples[i].size() < WINDOW)
+                        samples[i].push_back(current[i]);
+                    else
+                        samples[i][next] = current[i];
+                }
+                next = (next + 1) % WINDOW;
+                window_full = (++frames % WINDOW) == 0;
+            }
+
+            if (window_full && (!csv_checked || csv.is_open()))
+            {
+                FrameStats stats;
+                get(&stats);
+                write_csv(stats);
+            }
+        }
+
+        void get(FrameStats *out)
+        {
+            std::vector<float> sorted;
+            std::lock_guard<std::mutex> guard(lock);
+            out->samples = samples[0].size();
+            out->total_frames = frames;
+            for (int i = 0; i < FrameStats::NUM_SECTIONS; i++)
+            {
+                auto &p = out->section[i];
+                sorted = samples[i];
+                if (sorted.empty())
+                {
+                    p.p50 = p.p95 = p.p99 = p.max = p.mean = 0;
+                    continue;
+                }
+                std::sort(sorted.begin(), sorted.end());
+                size_t n = sorted.size();
+                p.p50 = sorted[n / 2];
+                p.p95 = sorted[std::min(n - 1, n * 95 / 100)];
+                p.p99 = sorted[std::min(n - 1, n * 99 / 100)];
+                p.max = sorted.back();
+                p.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+            }
+        }
+    };
+
+    FrameTelemetry frame_telemetry;
+}
+
+void Core::getFrameStats(FrameStats *out)
+{
+    frame_telemetry.get(out);
+}
+
 void Core::doUpdate(color_ostream &out, bool first_update)
 {
     Lua::Core::Reset(out, "DF code execution");
@@ -2024,6 +2547,8 @@ void Core::doUpdate(color_ostream &out, bool first_update)
         }
     }
 
+    frame_telemetry.lap(FrameStats::STATE_CHECKS);
+
     // Execute per-frame handlers
     onUpdate(out);
 
@@ -2038,6 +2563,8 @@ int Core::Update()
 
     color_ostream_proxy out(con);
 
+    frame_telemetry.begin();
+
     // Pretend this thread has suspended the core in the usual way,
     // and run various processing hooks.
     {
@@ -2060,6 +2587,9 @@ int Core::Update()
     CoreWakeup.wait(MainThread::suspend(),
             [this]() -> bool {return this->toolCount.load() == 0;});
 
+    frame_telemetry.lap(FrameStats::TOOLS);
+    frame_telemetry.end();
+
     return 0;
 };
 
@@ -2067,27 +2597,34 @@ extern bool buildings_do_onupdate;
 void buildings_onStateChange(color_ostream &out, state_change_event event);
 void buildings_onUpdate(color_ostream &out);
 
+void materials_onStateChange(color_ostream &out, state_change_event event);
+void items_onStateChange(color_ostream &out, state_change_event event);
+
 static int buildings_timer = 0;
 
 void Core::onUpdate(color_ostream &out)
 {
     EventManager::manageEvents(out);
+    frame_telemetry.lap(FrameStats::EVENT_MANAGER);
 
     // convert building reagents
     if (buildings_do_onupdate && (++buildings_timer & 1))
         buildings_onUpdate(out);
+    frame_telemetry.lap(FrameStats::BUILDINGS);
 
     // notify all the plugins that a game tick is finished
     plug_mgr->OnUpdate(out);
+    frame_telemetry.lap(FrameStats::PLUGINS);
 
     // process timers in lua
     Lua::Core::onUpdate(out);
+    frame_telemetry.lap(FrameStats::LUA_TIMERS);
 }
 
 void getFilesWithPrefixAndSuffix(const std::string& folder, const std::string& prefix, const std::string& suffix, std::vector<std::string>& result) {
     //DFHACK_EXPORT int listdir (std::string dir, std::vector<std::string> &files);
     std::vector<std::string> files;
-    DFHack::Filesystem::listdir(folder, files);
+    script_index.listFiles(folder, files);
     for ( size_t a = 0; a < files.size(); a++ ) {
         if ( prefix.length() > files[a].length() )
             continue;
@@ -2255,6 +2792,10 @@ void Core::onStateChange(color_ostream &out, state_change_event event)
         break;
     }
 
+    // Save-specific scripts are cached by full path; drop them with the world
+    if (event == SC_WORLD_UNLOADED)
+        Lua::ClearScriptCache();
+
     if (event == SC_WORLD_LOADED && Version::is_prerelease())
     {
         runCommand(out, "gui/prerelease-warning");
@@ -2265,6 +2806,10 @@ void Core::onStateChange(color_ostream &out, state_change_event event)
 
     buildings_onStateChange(out, event);
 
+    materials_onStateChange(out, event);
+
+    items_onStateChange(out, event);
+
     plug_mgr->OnStateChange(out, event);
 
     Lua::Core::onStateChange(out, event);
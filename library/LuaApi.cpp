@@ -1812,8 +1812,27 @@ static int items_moveToBuilding(lua_State *state)
 }
 
 
+static int items_getValues(lua_State *state)
+{
+    luaL_checktype(state, 1, LUA_TTABLE);
+    std::vector<df::item*> items;
+    int count = lua_rawlen(state, 1);
+    for (int i = 1; i <= count; i++)
+    {
+        lua_rawgeti(state, 1, i);
+        items.push_back(Lua::CheckDFObject<df::item>(state, -1));
+        lua_pop(state, 1);
+    }
+
+    std::vector<int> values;
+    Items::getValues(items, &values);
+    Lua::PushVector(state, values);
+    return 1;
+}
+
 static const luaL_Reg dfhack_items_funcs[] = {
     { "getPosition", items_getPosition },
+    { "getValues", items_getValues },
     { "getContainedItems", items_getContainedItems },
     { "moveToBuilding", items_moveToBuilding },
     { NULL, NULL }
@@ -2485,6 +2504,372 @@ static const LuaWrapper::FunctionReg dfhack_console_module[] = {
     { NULL, NULL }
 };
 
+/***** Bulk module *****/
+
+/*
+ * A field path compiled against one struct type. The object address is
+ * advanced by each entry of offsets in turn, dereferencing a pointer
+ * between consecutive entries; the final address is read as the leaf.
+ */
+struct bulk_path {
+    enum LeafMode {
+        LEAF_VALUE,
+        LEAF_STRING,
+        LEAF_BIT,
+        LEAF_POINTER,
+        LEAF_OBJECT
+    };
+
+    bool valid;
+    std::vector<size_t> offsets;
+    LeafMode mode;
+    type_identity *type;
+    int bit_idx, bit_size;
+    size_t str_size;
+
+    bulk_path() : valid(false), mode(LEAF_VALUE), type(NULL), bit_idx(0), bit_size(0), str_size(0) {}
+};
+
+static const struct_field_info *find_bulk_field(struct_identity *id, const std::string &name)
+{
+    for (struct_identity *p = id; p; p = p->getParent())
+    {
+        auto fields = p->getFields();
+        if (!fields)
+            continue;
+
+        for (int i = 0; fields[i].mode != struct_field_info::END; ++i)
+            if (fields[i].name == name)
+                return &fields[i];
+    }
+
+    return NULL;
+}
+
+static bool parse_bulk_index(const std::string &key, enum_identity *eid, int64_t *out)
+{
+    char *end;
+    long long val = strtoll(key.c_str(), &end, 10);
+    if (!key.empty() && *end == 0)
+    {
+        *out = val;
+        return true;
+    }
+
+    if (!eid)
+        return false;
+
+    auto keys = eid->getKeys();
+    auto complex = eid->getComplex();
+    for (int i = 0; i < eid->getCount(); i++)
+    {
+        if (keys[i] && key == keys[i])
+        {
+            *out = complex ? complex->index_value_map[i] : eid->getFirstItem() + i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool compile_bulk_path(bulk_path *out, struct_identity *root, const std::string &path)
+{
+    std::vector<std::string> names;
+    split_string(&names, path, ".");
+
+    type_identity *cur = root;
+    size_t offset = 0;
+    bool is_pointer = false;
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (is_pointer)
+        {
+            out->offsets.push_back(offset);
+            offset = 0;
+            is_pointer = false;
+        }
+
+        const std::string &name = names[i];
+
+        if (cur->type() == IDTYPE_BITFIELD)
+        {
+            auto bid = (bitfield_identity*)cur;
+            auto bits = bid->getBits();
+
+            if (i+1 != names.size())
+                return false;
+
+            for (int j = 0; j < bid->getNumBits(); j++)
+            {
+                if (bits[j].name && name == bits[j].name)
+                {
+                    out->offsets.push_back(offset);
+                    out->mode = bulk_path::LEAF_BIT;
+                    out->type = bid;
+                    out->bit_idx = j;
+                    out->bit_size = std::max(1, bits[j].size);
+                    out->valid = true;
+                    return true;
+                }
+                if (bits[j].size > 1)
+                    j += bits[j].size-1;
+            }
+
+            return false;
+        }
+
+        if (cur->type() != IDTYPE_STRUCT && cur->type() != IDTYPE_CLASS)
+            return false;
+
+        auto field = find_bulk_field((struct_identity*)cur, name);
+        if (!field)
+            return false;
+
+        offset += field->offset;
+
+        switch (field->mode)
+        {
+        case struct_field_info::PRIMITIVE:
+        case struct_field_info::SUBSTRUCT:
+            cur = field->type;
+            break;
+
+        case struct_field_info::POINTER:
+            if (!field->type)
+                return false;
+            cur = field->type;
+            is_pointer = true;
+            break;
+
+        case struct_field_info::STATIC_STRING:
+            if (i+1 != names.size())
+                return false;
+            out->offsets.push_back(offset);
+            out->mode = bulk_path::LEAF_STRING;
+            out->str_size = field->count;
+            out->valid = true;
+            return true;
+
+        case struct_field_info::STATIC_ARRAY:
+        case struct_field_info::CONTAINER:
+        {
+            type_identity *item = field->type;
+            size_t count = field->count;
+            enum_identity *eid = field->eid;
+
+            if (field->mode == struct_field_info::CONTAINER)
+            {
+                if (field->type->type() != IDTYPE_BUFFER)
+                {
+                    // Non-indexable containers may only be returned whole
+                    if (i+1 != names.size())
+                        return false;
+                    cur = field->type;
+                    break;
+                }
+
+                auto buf = (df::buffer_container_identity*)field->type;
+                item = buf->getItemType();
+                count = buf->getSize();
+                if (!eid)
+                    eid = (enum_identity*)buf->getIndexEnumType();
+            }
+
+            int64_t idx;
+            if (++i == names.size() || !item || !parse_bulk_index(names[i], eid, &idx))
+                return false;
+            if (idx < 0 || size_t(idx) >= count)
+                return false;
+
+            offset += size_t(idx) * item->byte_size();
+            cur = item;
+            break;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    out->offsets.push_back(offset);
+    out->type = cur;
+
+    if (is_pointer)
+        out->mode = bulk_path::LEAF_POINTER;
+    else if (cur->isPrimitive() && cur->type() != IDTYPE_POINTER)
+        out->mode = bulk_path::LEAF_VALUE;
+    else
+        out->mode = bulk_path::LEAF_OBJECT;
+
+    out->valid = true;
+    return true;
+}
+
+static void push_bulk_value(lua_State *L, const bulk_path &path, uint8_t *ptr)
+{
+    for (size_t i = 0; i+1 < path.offsets.size(); i++)
+    {
+        ptr = *(uint8_t**)(ptr + path.offsets[i]);
+        if (!ptr)
+        {
+            lua_pushnil(L);
+            return;
+        }
+    }
+
+    ptr += path.offsets.back();
+
+    switch (path.mode)
+    {
+    case bulk_path::LEAF_VALUE:
+        path.type->lua_read(L, 0, ptr);
+        break;
+
+    case bulk_path::LEAF_STRING:
+        lua_pushlstring(L, (char*)ptr, strnlen((char*)ptr, path.str_size));
+        break;
+
+    case bulk_path::LEAF_BIT:
+    {
+        int value = getBitfieldField(ptr, path.bit_idx, path.bit_size);
+        if (path.bit_size <= 1)
+            lua_pushboolean(L, value != 0);
+        else
+            lua_pushinteger(L, value);
+        break;
+    }
+
+    case bulk_path::LEAF_POINTER:
+        push_object_internal(L, path.type, *(void**)ptr, false);
+        break;
+
+    case bulk_path::LEAF_OBJECT:
+        push_object_internal(L, path.type, ptr, false);
+        break;
+    }
+}
+
+/*
+ * Paths compiled for each concrete type met in the container;
+ * subclasses of the item type are compiled lazily.
+ */
+typedef std::map<struct_identity*, std::vector<bulk_path> > bulk_path_cache;
+
+static std::vector<bulk_path> &get_bulk_paths(bulk_path_cache &cache, struct_identity *id,
+                                              const std::vector<std::string> &names)
+{
+    auto it = cache.find(id);
+    if (it != cache.end())
+        return it->second;
+
+    auto &paths = cache[id];
+    paths.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        compile_bulk_path(&paths[i], id, names[i]);
+    return paths;
+}
+
+// Every path keeps its column table on the Lua stack while extracting
+static const int MAX_BULK_PATHS = 1000;
+
+static int bulk_extract(lua_State *L)
+{
+    auto id = get_object_identity(L, 1, "dfhack.bulk.extract()", false);
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    if (!id->isContainer())
+        luaL_argerror(L, 1, "container expected");
+
+    auto cid = (container_identity*)id;
+    bool is_ptr = (cid->type() == IDTYPE_PTR_CONTAINER || cid->type() == IDTYPE_STL_PTR_VECTOR);
+    type_identity *item = cid->getItemType();
+
+    if (!item || (item->type() != IDTYPE_STRUCT && item->type() != IDTYPE_CLASS))
+        luaL_argerror(L, 1, "container of structures expected");
+
+    std::vector<std::string> names;
+    int npaths = lua_rawlen(L, 2);
+    if (npaths > MAX_BULK_PATHS)
+        luaL_argerror(L, 2, "too many field paths");
+    for (int i = 1; i <= npaths; i++)
+    {
+        lua_rawgeti(L, 2, i);
+        if (!lua_isstring(L, -1))
+            luaL_argerror(L, 2, "field path strings expected");
+        names.push_back(lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+
+    void *container = get_object_ref(L, 1);
+    int count = cid->get_item_count(container);
+
+    bulk_path_cache cache;
+    auto &base_paths = get_bulk_paths(cache, (struct_identity*)item, names);
+
+    if (item->type() != IDTYPE_CLASS)
+    {
+        for (size_t i = 0; i < names.size(); i++)
+            if (!base_paths[i].valid)
+                luaL_error(L, "Cannot extract field %s from %s", names[i].c_str(),
+                           item->getFullName().c_str());
+    }
+
+    // One column table per path, created up front, plus room for the values in flight
+    luaL_checkstack(L, npaths + 4, "bulk extract");
+    lua_createtable(L, 0, npaths);
+    int result = lua_gettop(L);
+    for (int i = 0; i < npaths; i++)
+    {
+        lua_createtable(L, count, 0);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, result, names[i].c_str());
+    }
+    int columns = result+1;
+
+    for (int idx = 0; idx < count; idx++)
+    {
+        uint8_t *ptr;
+        if (is_ptr)
+            ptr = *(uint8_t**)cid->get_item_pointer(&df::identity_traits<void*>::identity, container, idx);
+        else
+            ptr = (uint8_t*)cid->get_item_pointer(item, container, idx);
+
+        if (!ptr)
+            continue;
+
+        auto *paths = &base_paths;
+        if (item->type() == IDTYPE_CLASS)
+        {
+            auto vid = virtual_identity::get(virtual_ptr(ptr));
+            if (vid && vid != item)
+                paths = &get_bulk_paths(cache, vid, names);
+        }
+
+        for (int i = 0; i < npaths; i++)
+        {
+            if (!(*paths)[i].valid)
+                continue;
+            push_bulk_value(L, (*paths)[i], ptr);
+            lua_rawseti(L, columns+i, idx+1);
+        }
+    }
+
+    lua_settop(L, result);
+    lua_pushinteger(L, count);
+    return 2;
+}
+
+static const LuaWrapper::FunctionReg dfhack_bulk_module[] = {
+    { NULL, NULL }
+};
+
+static const luaL_Reg dfhack_bulk_funcs[] = {
+    { "extract", bulk_extract },
+    { NULL, NULL }
+};
+
 /***** Internal module *****/
 
 static void *checkaddr(lua_State *L, int idx, bool allow_null = false)
@@ -2968,6 +3353,77 @@ static int internal_md5file(lua_State *L)
     }
 }
 
+static int internal_loadScript(lua_State *L)
+{
+    std::string path = luaL_checkstring(L, 1);
+    int env_idx = 0;
+    if (!lua_isnoneornil(L, 2))
+    {
+        luaL_checktype(L, 2, LUA_TTABLE);
+        env_idx = 2;
+    }
+
+    if (Lua::LoadScript(L, path, env_idx) != LUA_OK)
+    {
+        lua_pushnil(L);
+        lua_insert(L, -2);
+        return 2;
+    }
+    return 1;
+}
+
+static int internal_getScriptCacheStats(lua_State *L)
+{
+    auto stats = Lua::GetScriptCacheStats();
+    size_t hits = stats.memory_hits + stats.disk_hits;
+    double saved = 0;
+    if (stats.compiled > 0 && hits > 0)
+        saved = hits * (stats.compile_ms / stats.compiled) - stats.cached_load_ms;
+
+    lua_createtable(L, 0, 6);
+    Lua::SetField(L, int(stats.compiled), -1, "compiled");
+    Lua::SetField(L, int(stats.memory_hits), -1, "memory_hits");
+    Lua::SetField(L, int(stats.disk_hits), -1, "disk_hits");
+    Lua::SetField(L, stats.compile_ms, -1, "compile_ms");
+    Lua::SetField(L, stats.cached_load_ms, -1, "cached_load_ms");
+    Lua::SetField(L, saved > 0 ? saved : 0.0, -1, "saved_ms");
+    return 1;
+}
+
+static int internal_getFrameStats(lua_State *L)
+{
+    FrameStats stats;
+    Core::getInstance().getFrameStats(&stats);
+
+    lua_createtable(L, 0, FrameStats::NUM_SECTIONS + 2);
+    Lua::SetField(L, int(stats.samples), -1, "samples");
+    Lua::SetField(L, double(stats.total_frames), -1, "total_frames");
+    for (int i = 0; i < FrameStats::NUM_SECTIONS; i++)
+    {
+        auto &p = stats.section[i];
+        lua_createtable(L, 0, 5);
+        Lua::SetField(L, p.p50, -1, "p50");
+        Lua::SetField(L, p.p95, -1, "p95");
+        Lua::SetField(L, p.p99, -1, "p99");
+        Lua::SetField(L, p.max, -1, "max");
+        Lua::SetField(L, p.mean, -1, "mean");
+        lua_setfield(L, -2, FrameStats::section_names[i]);
+    }
+    return 1;
+}
+
+static int internal_setScriptCachePersistent(lua_State *L)
+{
+    Lua::SetScriptCachePersistent(lua_toboolean(L, 1));
+    return 0;
+}
+
+static int internal_clearScriptCache(lua_State *L)
+{
+    Lua::ClearScriptCache();
+    return 0;
+}
+
 static const luaL_Reg dfhack_internal_funcs[] = {
     { "getPE", internal_getPE },
     { "getMD5", internal_getmd5 },
@@ -2991,6 +3447,11 @@ static const luaL_Reg dfhack_internal_funcs[] = {
     { "findScript", internal_findScript },
     { "threadid", internal_threadid },
     { "md5File", internal_md5file },
+    { "loadScript", internal_loadScript },
+    { "getScriptCacheStats", internal_getScriptCacheStats },
+    { "setScriptCachePersistent", internal_setScriptCachePersistent },
+    { "clearScriptCache", internal_clearScriptCache },
+    { "getFrameStats", internal_getFrameStats },
     { NULL, NULL }
 };
 
@@ -3022,5 +3483,6 @@ void OpenDFHackApi(lua_State *state)
     OpenModule(state, "designations", dfhack_designations_module, dfhack_designations_funcs);
     OpenModule(state, "kitchen", dfhack_kitchen_module);
     OpenModule(state, "console", dfhack_console_module);
+    OpenModule(state, "bulk", dfhack_bulk_module, dfhack_bulk_funcs);
     OpenModule(state, "internal", dfhack_internal_module, dfhack_internal_funcs);
 }
@@ -24,7 +24,12 @@ distribution.
 
 #include "Internal.h"
 
+#include <algorithm>
+#include <chrono>
 #include <csignal>
+#include <fstream>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <map>
@@ -38,6 +43,7 @@ distribution.
 #include "DataIdentity.h"
 #include "DataFuncs.h"
 
+#include "modules/Filesystem.h"
 #include "modules/World.h"
 #include "modules/Gui.h"
 #include "modules/Job.h"
@@ -50,6 +56,7 @@ distribution.
 #include "MiscUtils.h"
 #include "DFHackVersion.h"
 #include "PluginManager.h"
+#include "md5wrapper.h"
 
 #include "df/job.h"
 #include "df/job_item.h"
@@ -703,6 +710,7 @@ static int resume_helper(lua_State *L, lua_State *co, int narg, int nres)
         return LUA_ERRRUN;
     }
     lua_xmove(L, co, narg);
+    Lua::Profiler::Attach(co);
     int status = lua_resume(co, L, narg);
     if (Lua::IsSuccess(status))
     {
@@ -810,6 +818,211 @@ int DFHack::Lua::SafeResume(color_ostream &out, lua_State *from, int nargs, int
     return rv;
 }
 
+/*
+ * Compiled script cache
+ */
+
+namespace {
+    struct CachedScript {
+        int64_t mtime;
+        int64_t size;
+        std::string bytecode;
+    };
+
+    struct ScriptCacheData {
+        std::mutex lock;
+        std::map<std::string, CachedScript> scripts;
+        bool persistent;
+        Lua::ScriptCacheStats stats;
+
+        ScriptCacheData() : persistent(false), stats() {}
+    };
+
+    ScriptCacheData script_cache;
+
+    const char SCRIPT_CACHE_MAGIC[] = "DFHack script bytecode";
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        auto delta = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::milli>(delta).count();
+    }
+}
+
+static int script_cache_writer(lua_State *, const void *p, size_t size, void *ud)
+{
+    ((std::string*)ud)->append((const char*)p, size);
+    return 0;
+}
+
+static std::string script_cache_file(const std::string &path)
+{
+    static md5wrapper md5;
+    return Core::getInstance().getHackPath() + "cache/scripts/" +
+        md5.getHashFromString(path) + ".luac";
+}
+
+static std::string script_cache_header(const std::string &path, int64_t mtime, int64_t size)
+{
+    return stl_sprintf("%s\n%s\n%s\n%lld %lld\n", SCRIPT_CACHE_MAGIC, Version::git_commit(),
+                       path.c_str(), (long long)mtime, (long long)size);
+}
+
+static bool read_script_cache(const std::string &path, int64_t mtime, int64_t size,
+                              std::string *bytecode)
+{
+    std::ifstream in(script_cache_file(path), std::ios::binary);
+    if (!in)
+        return false;
+
+    std::string header = script_cache_header(path, mtime, size);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (data.compare(0, header.size(), header) != 0)
+        return false;
+
+    bytecode->assign(data, header.size(), std::string::npos);
+    return true;
+}
+
+static void write_script_cache(const std::string &path, int64_t mtime, int64_t size,
+                               const std::string &bytecode)
+{
+    std::string dir = Core::getInstance().getHackPath() + "cache";
+    if (!Filesystem::isdir(dir))
+        Filesystem::mkdir(dir);
+    dir += "/scripts";
+    if (!Filesystem::isdir(dir))
+        Filesystem::mkdir(dir);
+
+    std::string fname = script_cache_file(path);
+    std::string tmpname = fname + ".tmp";
+    {
+        std::ofstream out(tmpname, std::ios::binary);
+        if (!out)
+            return;
+        out << script_cache_header(path, mtime, size) << bytecode;
+        if (!out.good())
+            return;
+    }
+
+    remove(fname.c_str());
+    rename(tmpname.c_str(), fname.c_str());
+}
+
+int DFHack::Lua::LoadScript(lua_State *state, const std::string &path, int env_idx)
+{
+    if (env_idx)
+        env_idx = lua_absindex(state, env_idx);
+
+    STAT_STRUCT info;
+    if (!Filesystem::stat(path, info))
+    {
+        lua_pushfstring(state, "cannot open %s", path.c_str());
+        return LUA_ERRFILE;
+    }
+
+    int64_t mtime = info.st_mtime;
+    int64_t size = info.st_size;
+    std::string chunkname = "@" + path;
+
+    std::string bytecode;
+    bool cached = false, from_disk = false, persistent;
+    {
+        std::lock_guard<std::mutex> lock(script_cache.lock);
+        auto it = script_cache.scripts.find(path);
+        if (it != script_cache.scripts.end() &&
+            it->second.mtime == mtime && it->second.size == size)
+        {
+            bytecode = it->second.bytecode;
+            cached = true;
+        }
+        persistent = script_cache.persistent;
+    }
+
+    if (!cached && persistent && read_script_cache(path, mtime, size, &bytecode))
+        cached = from_disk = true;
+
+    if (cached)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (luaL_loadbufferx(state, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") == LUA_OK)
+        {
+            double ms = elapsed_ms(start);
+
+            std::lock_guard<std::mutex> lock(script_cache.lock);
+            script_cache.stats.cached_load_ms += ms;
+            if (from_disk)
+            {
+                script_cache.stats.disk_hits++;
+                CachedScript &entry = script_cache.scripts[path];
+                entry.mtime = mtime;
+                entry.size = size;
+                entry.bytecode.swap(bytecode);
+            }
+            else
+                script_cache.stats.memory_hits++;
+        }
+        else
+        {
+            // Stale or corrupt cache entry: compile from source instead
+            lua_pop(state, 1);
+            cached = false;
+        }
+    }
+
+    if (!cached)
+    {
+        auto start = std::chrono::steady_clock::now();
+        int status = luaL_loadfilex(state, path.c_str(), "t");
+        if (status != LUA_OK)
+            return status;
+        double ms = elapsed_ms(start);
+
+        bytecode.clear();
+        lua_dump(state, script_cache_writer, &bytecode, 0);
+
+        if (persistent)
+            write_script_cache(path, mtime, size, bytecode);
+
+        std::lock_guard<std::mutex> lock(script_cache.lock);
+        script_cache.stats.compiled++;
+        script_cache.stats.compile_ms += ms;
+        CachedScript &entry = script_cache.scripts[path];
+        entry.mtime = mtime;
+        entry.size = size;
+        entry.bytecode.swap(bytecode);
+    }
+
+    if (env_idx)
+    {
+        // The first upvalue of a main chunk is its _ENV
+        lua_pushvalue(state, env_idx);
+        if (!lua_setupvalue(state, -2, 1))
+            lua_pop(state, 1);
+    }
+
+    return LUA_OK;
+}
+
+Lua::ScriptCacheStats DFHack::Lua::GetScriptCacheStats()
+{
+    std::lock_guard<std::mutex> lock(script_cache.lock);
+    return script_cache.stats;
+}
+
+void DFHack::Lua::SetScriptCachePersistent(bool persistent)
+{
+    std::lock_guard<std::mutex> lock(script_cache.lock);
+    script_cache.persistent = persistent;
+}
+
+void DFHack::Lua::ClearScriptCache()
+{
+    std::lock_guard<std::mutex> lock(script_cache.lock);
+    script_cache.scripts.clear();
+}
+
 /*
  * Module loading
  */
@@ -1593,6 +1806,253 @@ void DFHack::Lua::Notification::bind(lua_State *state, const char *name)
     this->key = this;
 }
 
+/**************
+ *  Profiler  *
+ **************/
+
+namespace {
+    struct ProfilerData {
+        bool active;
+        int period;
+        std::string target;
+        std::vector<std::string> scopes;
+        std::map<std::string, size_t> stacks;
+        size_t samples;
+
+        ProfilerData() : active(false), period(0), samples(0) {}
+    };
+
+    ProfilerData profiler;
+
+    const int PROFILER_MAX_DEPTH = 64;
+}
+
+static bool profiler_in_target()
+{
+    if (profiler.target.empty())
+        return true;
+
+    for (auto it = profiler.scopes.begin(); it != profiler.scopes.end(); ++it)
+        if (it->compare(0, profiler.target.size(), profiler.target) == 0)
+            return true;
+
+    return false;
+}
+
+static void profiler_hook(lua_State *L, lua_Debug *)
+{
+    if (!profiler.active)
+    {
+        lua_sethook(L, NULL, 0, 0);
+        return;
+    }
+
+    if (!profiler_in_target())
+        return;
+
+    std::vector<std::string> frames;
+    lua_Debug info;
+
+    for (int level = 0; level < PROFILER_MAX_DEPTH && lua_getstack(L, level, &info); level++)
+    {
+        if (!lua_getinfo(L, "Sln", &info))
+            break;
+
+        const char *name = info.name;
+        if (!name)
+            name = (strcmp(info.what, "main") == 0) ? "main" : "?";
+
+        if (strcmp(info.what, "C") == 0)
+            frames.push_back(stl_sprintf("%s [C]", name));
+        else
+            frames.push_back(stl_sprintf("%s@%s:%d", name, info.short_src,
+                                         (level == 0) ? info.currentline : info.linedefined));
+    }
+
+    std::string key;
+    for (auto it = profiler.scopes.begin(); it != profiler.scopes.end(); ++it)
+        key += "[" + *it + "];";
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+    {
+        // ';' separates frames in the output
+        std::replace(it->begin(), it->end(), ';', ',');
+        key += *it + ";";
+    }
+
+    if (key.empty())
+        return;
+
+    key.erase(key.size()-1);
+
+    profiler.stacks[key]++;
+    profiler.samples++;
+}
+
+void DFHack::Lua::Profiler::Attach(lua_State *thread)
+{
+    if (!profiler.active)
+        return;
+
+    // Don't override hooks installed by debug.sethook
+    lua_Hook hook = lua_gethook(thread);
+    if (hook && hook != profiler_hook)
+        return;
+
+    if (hook != profiler_hook || lua_gethookcount(thread) != profiler.period)
+        lua_sethook(thread, profiler_hook, LUA_MASKCOUNT, profiler.period);
+}
+
+static void profiler_detach(lua_State *thread)
+{
+    if (lua_gethook(thread) == profiler_hook)
+        lua_sethook(thread, NULL, 0, 0);
+}
+
+void DFHack::Lua::Profiler::Start(lua_State *state, int period, const std::string &target)
+{
+    AssertCoreSuspend(state);
+
+    profiler.active = true;
+    profiler.period = std::max(1, period);
+    profiler.target = target;
+
+    Attach(state);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+    Attach(lua_tothread(state, -1));
+    lua_pop(state, 1);
+}
+
+void DFHack::Lua::Profiler::Stop(lua_State *state)
+{
+    AssertCoreSuspend(state);
+
+    // Other coroutines remove the hook on the next sample
+    profiler.active = false;
+
+    profiler_detach(state);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+    profiler_detach(lua_tothread(state, -1));
+    lua_pop(state, 1);
+}
+
+bool DFHack::Lua::Profiler::IsActive()
+{
+    return profiler.active;
+}
+
+void DFHack::Lua::Profiler::Reset()
+{
+    profiler.stacks.clear();
+    profiler.samples = 0;
+}
+
+size_t DFHack::Lua::Profiler::GetSampleCount()
+{
+    return profiler.samples;
+}
+
+void DFHack::Lua::Profiler::Dump(std::ostream &out)
+{
+    for (auto it = profiler.stacks.begin(); it != profiler.stacks.end(); ++it)
+        out << it->first << ' ' << it->second << '\n';
+}
+
+DFHack::Lua::Profiler::Scope::Scope(const char *kind, const std::string &name)
+    : pushed(false)
+{
+    if (!profiler.active)
+        return;
+
+    profiler.scopes.push_back(std::string(kind) + ":" + name);
+    pushed = true;
+}
+
+DFHack::Lua::Profiler::Scope::~Scope()
+{
+    if (pushed && !profiler.scopes.empty())
+        profiler.scopes.pop_back();
+}
+
+static int dfhack_profiler_start(lua_State *L)
+{
+    int period = luaL_optint(L, 1, 1000);
+    const char *target = luaL_optstring(L, 2, "");
+    Lua::Profiler::Start(L, period, target);
+    return 0;
+}
+
+static int dfhack_profiler_stop(lua_State *L)
+{
+    Lua::Profiler::Stop(L);
+    return 0;
+}
+
+static int dfhack_profiler_reset(lua_State *L)
+{
+    Lua::Profiler::Reset();
+    return 0;
+}
+
+static int dfhack_profiler_is_active(lua_State *L)
+{
+    lua_pushboolean(L, Lua::Profiler::IsActive());
+    return 1;
+}
+
+static int dfhack_profiler_get_sample_count(lua_State *L)
+{
+    lua_pushinteger(L, Lua::Profiler::GetSampleCount());
+    return 1;
+}
+
+static int dfhack_profiler_dump(lua_State *L)
+{
+    std::stringstream ss;
+    Lua::Profiler::Dump(ss);
+
+    if (lua_isnoneornil(L, 1))
+    {
+        lua_pushstring(L, ss.str().c_str());
+        return 1;
+    }
+
+    const char *path = luaL_checkstring(L, 1);
+    std::ofstream out(path);
+    if (!out.good())
+        luaL_error(L, "could not open %s for writing", path);
+    out << ss.str();
+    lua_pushboolean(L, out.good());
+    return 1;
+}
+
+static int dfhack_profiler_call_cont(lua_State *L, int, lua_KContext)
+{
+    return lua_gettop(L) - 2;
+}
+
+static int dfhack_profiler_call(lua_State *L)
+{
+    const char *kind = luaL_checkstring(L, 1);
+    const char *name = luaL_checkstring(L, 2);
+    luaL_checktype(L, 3, LUA_TFUNCTION);
+
+    // The scope is left when the function yields
+    Lua::Profiler::Scope scope(kind, name);
+    lua_callk(L, lua_gettop(L) - 3, LUA_MULTRET, 0, dfhack_profiler_call_cont);
+    return dfhack_profiler_call_cont(L, LUA_OK, 0);
+}
+
+static const luaL_Reg dfhack_profiler_funcs[] = {
+    { "start", dfhack_profiler_start },
+    { "stop", dfhack_profiler_stop },
+    { "reset", dfhack_profiler_reset },
+    { "isActive", dfhack_profiler_is_active },
+    { "getSampleCount", dfhack_profiler_get_sample_count },
+    { "dump", dfhack_profiler_dump },
+    { "call", dfhack_profiler_call },
+    { NULL, NULL }
+};
+
 /************************
  *  Main Open function  *
  ************************/
@@ -1822,6 +2282,7 @@ static void cancel_timers(std::multimap<int,int> &timers)
     using Lua::Core::State;
 
     Lua::StackUnwinder frame(State);
+    Lua::Profiler::Scope scope("core", "timers");
     lua_rawgetp(State, LUA_REGISTRYINDEX, &DFHACK_TIMEOUTS_TOKEN);
 
     for (auto it = timers.begin(); it != timers.end(); ++it)
@@ -1917,6 +2378,10 @@ static void Lua::Core::InitCoreContext()
     lua_pushcfunction(State, dfhack_timeout_active);
     lua_setfield(State, -2, "timeout_active");
 
+    lua_newtable(State);
+    luaL_setfuncs(State, dfhack_profiler_funcs, 0);
+    lua_setfield(State, -2, "profiler");
+
     lua_pop(State, 1);
 }
 
@@ -414,8 +414,49 @@ static int get_metafield(lua_State *state)
     return 1;
 }
 
+/**
+ * Remember a successful field lookup in the per-state FieldCache.
+ */
+static void cache_field(lua_State *state, int index, void *field)
+{
+    auto cache = get_field_cache(state);
+    if (!cache || lua_type(state, index) != LUA_TSTRING)
+        return;
+
+    // Anchor the name, and use the address of the anchored copy
+    lua_rawgetp(state, LUA_REGISTRYINDEX, &DFHACK_FIELD_NAMES_TOKEN);
+    lua_pushvalue(state, index);
+    if (lua_rawget(state, -2) == LUA_TNIL)
+    {
+        lua_pop(state, 1);
+        lua_pushvalue(state, index);
+        lua_pushvalue(state, index);
+        lua_rawset(state, -3);
+        lua_pushvalue(state, index);
+        lua_rawget(state, -2);
+    }
+    const char *key = lua_tostring(state, -1);
+    lua_pop(state, 2);
+
+    const void *table = lua_topointer(state, UPVAL_FIELDTABLE);
+    auto &entry = cache->entries[FieldCache::hash(table, key)];
+    entry.table = table;
+    entry.key = key;
+    entry.field = field;
+}
+
 static void *find_field(lua_State *state, int index, const char *mode)
 {
+    auto cache = get_field_cache(state);
+    if (cache && lua_type(state, index) == LUA_TSTRING)
+    {
+        const void *table = lua_topointer(state, UPVAL_FIELDTABLE);
+        const char *key = lua_tostring(state, index);
+        auto &entry = cache->entries[FieldCache::hash(table, key)];
+        if (entry.table == table && entry.key == key)
+            return entry.field;
+    }
+
     lookup_field(state, index, mode);
 
     // Methods
@@ -432,6 +473,8 @@ static void *find_field(lua_State *state, int index, const char *mode)
     // NULL => metafield
     if (!p)
         get_metafield(state);
+    else
+        cache_field(state, index, p);
     return p;
 }
 
@@ -168,11 +168,49 @@ static void BuildTypeMetatable(lua_State *state, type_identity *type);
 void LuaWrapper::push_object_ref(lua_State *state, void *ptr)
 {
     // stack: [metatable]
+    int slot = int((uintptr_t(ptr) >> 3) & (OBJ_CACHE_SIZE-1)) + 1;
+
+    lua_rawgetp(state, LUA_REGISTRYINDEX, &DFHACK_OBJ_CACHE_TOKEN);
+    bool has_cache = lua_istable(state, -1);
+
+    if (has_cache && lua_rawgeti(state, -1, slot) == LUA_TUSERDATA)
+    {
+        // stack: [metatable] [cache] [userdata]
+        auto ref = (DFRefHeader*)lua_touserdata(state, -1);
+
+        if (ref->ptr == ptr && lua_getmetatable(state, -1))
+        {
+            bool same = lua_rawequal(state, -1, -4);
+            lua_pop(state, 1);
+
+            if (same)
+            {
+                lua_replace(state, -3);
+                lua_pop(state, 1);
+                // stack: [userdata]
+                return;
+            }
+        }
+    }
+
+    if (has_cache)
+        lua_pop(state, 1);
+
     auto ref = (DFRefHeader*)lua_newuserdata(state, sizeof(DFRefHeader));
     ref->ptr = ptr;
 
-    lua_swap(state);
+    // stack: [metatable] [cache] [userdata]
+    lua_pushvalue(state, -3);
     lua_setmetatable(state, -2);
+
+    if (has_cache)
+    {
+        lua_dup(state);
+        lua_rawseti(state, -3, slot);
+    }
+
+    lua_replace(state, -3);
+    lua_pop(state, 1);
     // stack: [userdata]
 }
 
@@ -1710,6 +1748,26 @@ static int DoAttach(lua_State *state)
     lua_newtable(state);
     lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_PTR_IDTABLE_TOKEN);
 
+    {
+        // The cache is owned by the registry, and published via the
+        // extra space of the main thread so that coroutines inherit it.
+        auto cache = (FieldCache*)lua_newuserdata(state, sizeof(FieldCache));
+        memset(cache, 0, sizeof(FieldCache));
+        lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_FIELD_CACHE_TOKEN);
+
+        lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+        *(FieldCache**)lua_getextraspace(lua_tothread(state, -1)) = cache;
+        if (lua_tothread(state, -1) != state)
+            *(FieldCache**)lua_getextraspace(state) = cache;
+        lua_pop(state, 1);
+
+        lua_newtable(state);
+        lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_FIELD_NAMES_TOKEN);
+
+        lua_createtable(state, OBJ_CACHE_SIZE, 0);
+        lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_OBJ_CACHE_TOKEN);
+    }
+
     lua_newtable(state);
     lua_rawsetp(state, LUA_REGISTRYINDEX, &DFHACK_TYPEID_TABLE_TOKEN);
 
@@ -1840,5 +1898,8 @@ namespace DFHack { namespace LuaWrapper {
     LuaToken DFHACK_TYPEID_TABLE_TOKEN;
     LuaToken DFHACK_ENUM_TABLE_TOKEN;
     LuaToken DFHACK_PTR_IDTABLE_TOKEN;
+    LuaToken DFHACK_FIELD_CACHE_TOKEN;
+    LuaToken DFHACK_FIELD_NAMES_TOKEN;
+    LuaToken DFHACK_OBJ_CACHE_TOKEN;
     LuaToken DFHACK_EMPTY_TABLE_TOKEN;
 }}
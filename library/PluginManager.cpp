@@ -46,6 +46,11 @@ using namespace DFHack;
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
 using namespace std;
 
 #include "tinythread.h"
@@ -198,6 +203,7 @@ Plugin::Plugin(Core * core, const std::string & path,
     plugin_enable = 0;
     plugin_is_enabled = 0;
     state = PS_UNLOADED;
+    deferred = false;
     access = new RefLock();
 }
 
@@ -243,6 +249,13 @@ bool Plugin::load(color_ostream &con)
             return false;
         }
         state = PS_LOADING;
+        if (deferred)
+        {
+            // drop the commands registered from the manifest
+            deferred = false;
+            parent->unregisterCommands(this);
+            commands.clear();
+        }
     }
     // enter suspend
     CoreSuspender suspend;
@@ -357,6 +370,7 @@ bool Plugin::load(color_ostream &con)
         RefAutolock lock(access);
         state = PS_LOADED;
         parent->registerCommands(this);
+        write_manifest();
         if ((plugin_onupdate || plugin_enable) && !plugin_is_enabled)
             con.printerr("Plugin %s has no enabled var!\n", name.c_str());
         fprintf(stderr, "loaded plugin %s; DFHack build %s\n", name.c_str(), plug_git_desc);
@@ -430,6 +444,12 @@ bool Plugin::unload(color_ostream &con)
     }
     else if(state == PS_UNLOADED || state == PS_DELETED)
     {
+        if (deferred)
+        {
+            deferred = false;
+            parent->unregisterCommands(this);
+            commands.clear();
+        }
         access->unlock();
         return true;
     }
@@ -439,6 +459,147 @@ bool Plugin::unload(color_ostream &con)
     return false;
 }
 
+/*
+ * Deferred loading: the commands of a plugin listed in
+ * dfhack-config/lazy-plugins.txt are registered from a manifest written
+ * the last time it was loaded, and the plugin is loaded on first use.
+ */
+static const char *manifest_header = "dfhack-plugin-manifest 1";
+
+static string manifest_escape(const string &str)
+{
+    string rv;
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '\\': rv += "\\\\"; break;
+        case '\n': rv += "\\n"; break;
+        case '\t': rv += "\\t"; break;
+        default: rv += c;
+        }
+    }
+    return rv;
+}
+
+static string manifest_unescape(const string &str)
+{
+    string rv;
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        if (str[i] == '\\' && i + 1 < str.size())
+        {
+            char c = str[++i];
+            rv += (c == 'n') ? '\n' : (c == 't') ? '\t' : c;
+        }
+        else
+            rv += str[i];
+    }
+    return rv;
+}
+
+string Plugin::manifest_path()
+{
+    return Core::getInstance().getHackPath() + "cache/plugins/" + name + ".txt";
+}
+
+string Plugin::manifest_fingerprint()
+{
+    STAT_STRUCT info;
+    if (!Filesystem::stat(path, info))
+        return "";
+    return stl_sprintf("%lld %lld %s", (long long)info.st_size, (long long)info.st_mtime,
+                       Version::git_description());
+}
+
+void Plugin::write_manifest()
+{
+    string fingerprint = manifest_fingerprint();
+    if (fingerprint.empty())
+        return;
+
+    string fname = manifest_path();
+    {
+        ifstream in(fname);
+        string header, old_fingerprint;
+        if (getline(in, header) && header == manifest_header &&
+            getline(in, old_fingerprint) && old_fingerprint == fingerprint)
+            return;
+    }
+
+    string dir = Core::getInstance().getHackPath() + "cache";
+    if (!Filesystem::isdir(dir))
+        Filesystem::mkdir(dir);
+    dir += "/plugins";
+    if (!Filesystem::isdir(dir))
+        Filesystem::mkdir(dir);
+
+    ofstream out(fname);
+    if (!out)
+        return;
+
+    out << manifest_header << "\n" << fingerprint << "\n";
+    for (auto &cmd : commands)
+    {
+        // hotkey guards cannot be evaluated without the plugin
+        out << (cmd.isHotkeyCommand() ? "hotkey" : "command") << "\t"
+            << manifest_escape(cmd.name) << "\t"
+            << manifest_escape(cmd.description) << "\t"
+            << (cmd.interactive ? 1 : 0) << "\t"
+            << manifest_escape(cmd.usage) << "\n";
+    }
+}
+
+bool Plugin::defer()
+{
+    RefAutolock lock(access);
+    if (deferred)
+        return true;
+    if (state != PS_UNLOADED)
+        return false;
+
+    string fingerprint = manifest_fingerprint();
+    ifstream in(manifest_path());
+    string line;
+    if (fingerprint.empty() || !getline(in, line) || line != manifest_header ||
+        !getline(in, line) || line != fingerprint)
+        return false;
+
+    std::vector<PluginCommand> stubs;
+    while (getline(in, line))
+    {
+        std::vector<string> fields;
+        split_string(&fields, line, "\t");
+        if (fields.size() != 5 || fields[0] != "command")
+            return false;
+
+        stubs.push_back(PluginCommand(
+            "", "", NULL, fields[3] == "1"
+        ));
+        stubs.back().name = manifest_unescape(fields[1]);
+        stubs.back().description = manifest_unescape(fields[2]);
+        stubs.back().usage = manifest_unescape(fields[4]);
+    }
+
+    commands.swap(stubs);
+    deferred = true;
+    parent->registerCommands(this);
+    fprintf(stderr, "deferred loading plugin %s\n", name.c_str());
+    return true;
+}
+
+bool Plugin::load_if_deferred(color_ostream &out)
+{
+    {
+        RefAutolock lock(access);
+        if (!deferred)
+            return state == PS_LOADED;
+    }
+
+    MUTEX_GUARD(parent->plugin_mutex);
+    return load(out);
+}
+
 bool Plugin::reload(color_ostream &out)
 {
     if(state != PS_LOADED)
@@ -454,6 +615,7 @@ command_result Plugin::invoke(color_ostream &out, const std::string & command, s
 {
     Core & c = Core::getInstance();
     command_result cr = CR_NOT_IMPLEMENTED;
+    load_if_deferred(out);
     access->lock_add();
     if(state == PS_LOADED)
     {
@@ -535,6 +697,7 @@ command_result Plugin::on_update(color_ostream &out)
     access->lock_add();
     if(state == PS_LOADED && plugin_onupdate)
     {
+        Lua::Profiler::Scope scope("onupdate", name);
         cr = plugin_onupdate(out);
         Lua::Core::Reset(out, "plugin_onupdate");
     }
@@ -574,6 +737,8 @@ RPCService *Plugin::rpc_connect(color_ostream &out)
 {
     RPCService *rv = NULL;
 
+    load_if_deferred(out);
+
     access->lock_add();
 
     if(state == PS_LOADED && plugin_rpcconnect)
@@ -703,6 +868,7 @@ int Plugin::lua_cmd_wrapper(lua_State *state)
         luaL_error(state, "plugin command %s() has been unloaded",
                    (cmd->owner->name+"."+cmd->name).c_str());
 
+    Lua::Profiler::Scope scope("plugin", cmd->owner->name);
     return Lua::CallWithCatch(state, cmd->command, cmd->name.c_str());
 }
 
@@ -721,6 +887,7 @@ int Plugin::lua_fun_wrapper(lua_State *state)
                    (cmd->owner->name+"."+cmd->name).c_str());
     }
 
+    Lua::Profiler::Scope scope("plugin", cmd->owner->name);
     return LuaWrapper::method_wrapper_core(state, cmd->identity);
 }
 
@@ -728,6 +895,8 @@ void Plugin::open_lua(lua_State *state, int table)
 {
     table = lua_absindex(state, table);
 
+    load_if_deferred(Core::getInstance().getConsole());
+
     RefAutolock lock(access);
 
     if (plugin_is_enabled)
@@ -885,13 +1054,74 @@ bool PluginManager::load (const string &name)
     return p->load(core->getConsole());
 }
 
+std::set<string> PluginManager::lazyPlugins()
+{
+    std::set<string> names;
+    ifstream in("dfhack-config/lazy-plugins.txt");
+    string line;
+    while (getline(in, line))
+    {
+        size_t end = line.find_last_not_of(" \t\r");
+        line.erase(end == string::npos ? 0 : end + 1);
+        if (!line.empty() && line[0] != '#')
+            names.insert(line);
+    }
+    return names;
+}
+
+void PluginManager::prefetch(const std::vector<string> &names)
+{
+    // dlopen() serializes on the loader lock and runs the static
+    // initializers of each plugin, so only the disk reads are done in
+    // parallel here; the serial load below then hits the page cache.
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        std::vector<char> buf(1 << 16);
+        for (size_t i; (i = next++) < names.size(); )
+        {
+            ifstream in(getPluginPath(names[i]), ios::binary);
+            while (in.read(buf.data(), buf.size()))
+                ;
+        }
+    };
+
+    size_t count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < count; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+}
+
 bool PluginManager::loadAll()
 {
     MUTEX_GUARD(plugin_mutex);
     auto files = listPlugins();
+    auto lazy = lazyPlugins();
+    bool lazy_all = lazy.count("*") != 0;
     bool ok = true;
-    // load all plugins in hack/plugins
+
+    std::vector<string> to_load;
     for (auto f = files.begin(); f != files.end(); ++f)
+    {
+        if (lazy_all || lazy.count(*f))
+        {
+            if (!(*this)[*f] && !addPlugin(*f))
+            {
+                ok = false;
+                continue;
+            }
+            if ((*this)[*f]->defer())
+                continue;
+        }
+        to_load.push_back(*f);
+    }
+
+    prefetch(to_load);
+
+    // load all plugins in hack/plugins
+    for (auto f = to_load.begin(); f != to_load.end(); ++f)
     {
         if (!load(*f))
             ok = false;
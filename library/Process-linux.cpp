@@ -27,6 +27,7 @@ distribution.
 #include <errno.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include <string>
@@ -35,6 +36,7 @@ distribution.
 #include <set>
 #include <cstdio>
 #include <cstring>
+#include <fstream>
 using namespace std;
 
 #include <md5wrapper.h>
@@ -46,6 +48,45 @@ using namespace std;
 #include <string.h>
 using namespace DFHack;
 
+/*
+ * Hashing the whole executable is a noticeable part of startup, so the
+ * result is cached in hack/cache, keyed by the file's identity and
+ * modification times.
+ */
+static const char *exe_md5_cache_name = "hack/cache/exe-md5.txt";
+
+static string exe_fingerprint(const string &exe_name)
+{
+    struct stat info;
+    if (stat(exe_name.c_str(), &info) != 0)
+        return "";
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%llu %llu %lld %lld.%09ld %lld.%09ld",
+             (unsigned long long)info.st_dev, (unsigned long long)info.st_ino,
+             (long long)info.st_size,
+             (long long)info.st_mtim.tv_sec, (long)info.st_mtim.tv_nsec,
+             (long long)info.st_ctim.tv_sec, (long)info.st_ctim.tv_nsec);
+    return buf;
+}
+
+static bool read_exe_md5_cache(const string &fingerprint, string *md5, uint32_t *length)
+{
+    ifstream in(exe_md5_cache_name);
+    string cached_fingerprint;
+    if (!in || !getline(in, cached_fingerprint) || cached_fingerprint != fingerprint)
+        return false;
+    return bool(in >> *md5 >> *length) && md5->size() == 32;
+}
+
+static void write_exe_md5_cache(const string &fingerprint, const string &md5, uint32_t length)
+{
+    mkdir("hack/cache", 0755);
+    ofstream out(exe_md5_cache_name);
+    if (out)
+        out << fingerprint << "\n" << md5 << " " << length << "\n";
+}
+
 Process::Process(const VersionInfoFactory& known_versions) : identified(false), my_pe(0)
 {
     const char * dir_name = "/proc/self/";
@@ -68,9 +109,22 @@ Process::Process(const VersionInfoFactory& known_versions) : identified(false),
     uint8_t first_kb [1024];
     memset(first_kb, 0, sizeof(first_kb));
     // get hash of the running DF process
-    my_md5 = md5.getHashFromFile(self_exe_name, length, (char *) first_kb);
+    string fingerprint = exe_fingerprint(self_exe_name);
+    bool from_cache = !fingerprint.empty() && read_exe_md5_cache(fingerprint, &my_md5, &length);
+    if (!from_cache)
+    {
+        my_md5 = md5.getHashFromFile(self_exe_name, length, (char *) first_kb);
+        if (!fingerprint.empty() && my_md5.size() == 32)
+            write_exe_md5_cache(fingerprint, my_md5, length);
+    }
     // create linux process, add it to the vector
     auto vinfo = known_versions.getVersionInfoByMD5(my_md5);
+    if (!vinfo && from_cache)
+    {
+        // the hash came from the cache; rehash for the diagnostics below
+        my_md5 = md5.getHashFromFile(self_exe_name, length, (char *) first_kb);
+        vinfo = known_versions.getVersionInfoByMD5(my_md5);
+    }
     if(vinfo)
     {
         my_descriptor = std::make_shared<VersionInfo>(*vinfo);
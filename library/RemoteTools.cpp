@@ -372,6 +372,28 @@ static command_result GetDFVersion(color_ostream &stream,
     return CR_OK;
 }
 
+static command_result GetFrameStats(color_ostream &stream,
+                                    const EmptyMessage *, GetFrameStatsOut *out)
+{
+    FrameStats stats;
+    Core::getInstance().getFrameStats(&stats);
+
+    out->set_samples(stats.samples);
+    out->set_total_frames(stats.total_frames);
+    for (int i = 0; i < FrameStats::NUM_SECTIONS; i++)
+    {
+        auto &p = stats.section[i];
+        auto item = out->add_section();
+        item->set_name(FrameStats::section_names[i]);
+        item->set_p50(p.p50);
+        item->set_p95(p.p95);
+        item->set_p99(p.p99);
+        item->set_max(p.max);
+        item->set_mean(p.mean);
+    }
+    return CR_OK;
+}
+
 static command_result GetWorldInfo(color_ostream &stream,
                                    const EmptyMessage *, GetWorldInfoOut *out)
 {
@@ -670,6 +692,7 @@ CoreService::CoreService() :
     // Functions:
     addFunction("GetVersion", GetVersion, SF_DONT_SUSPEND | SF_ALLOW_REMOTE);
     addFunction("GetDFVersion", GetDFVersion, SF_DONT_SUSPEND | SF_ALLOW_REMOTE);
+    addFunction("GetFrameStats", GetFrameStats, SF_DONT_SUSPEND | SF_ALLOW_REMOTE);
 
     addFunction("GetWorldInfo", GetWorldInfo, SF_ALLOW_REMOTE);
 
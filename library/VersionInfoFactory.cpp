@@ -29,6 +29,9 @@ distribution.
 #include <algorithm>
 #include <map>
 #include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
 using namespace std;
 
 #include "VersionInfoFactory.h"
@@ -36,13 +39,41 @@ using namespace std;
 #include "Error.h"
 #include "Memory.h"
 #include "PluginManager.h"
+#include "modules/Filesystem.h"
 using namespace DFHack;
 
 #include <tinyxml.h>
+#include <md5wrapper.h>
+
+/*
+ * Contents of a <symbol-table> element. Symbols given by mangled name
+ * are resolved, and the DFHACK_NO_* variables applied, only when the
+ * VersionInfo is built, so this can be cached between runs.
+ */
+struct VersionInfoFactory::SymbolTable
+{
+    struct Entry
+    {
+        bool is_vtable;
+        string key;
+        string value;
+        string mangled;
+        string offset;
+    };
+
+    string name;
+    OSType os;
+    vector<string> md5s;
+    vector<uintptr_t> pes;
+    vector<Entry> entries;
+
+    SymbolTable() : os(OS_BAD) {}
+};
 
 VersionInfoFactory::VersionInfoFactory()
 {
     error = false;
+    from_cache = false;
 }
 
 VersionInfoFactory::~VersionInfoFactory()
@@ -53,7 +84,9 @@ VersionInfoFactory::~VersionInfoFactory()
 void VersionInfoFactory::clear()
 {
     versions.clear();
+    tables.clear();
     error = false;
+    from_cache = false;
 }
 
 std::shared_ptr<const VersionInfo> VersionInfoFactory::getVersionInfoByMD5(string hash) const
@@ -76,10 +109,8 @@ std::shared_ptr<const VersionInfo> VersionInfoFactory::getVersionInfoByPETimesta
     return nullptr;
 }
 
-void VersionInfoFactory::ParseVersion (TiXmlElement* entry, VersionInfo* mem)
+void VersionInfoFactory::ParseVersion (TiXmlElement* entry, SymbolTable* table)
 {
-    bool no_vtables = getenv("DFHACK_NO_VTABLES");
-    bool no_globals = getenv("DFHACK_NO_GLOBALS");
     TiXmlElement* pMemEntry;
     const char *cstr_name = entry->Attribute("name");
     if (!cstr_name)
@@ -90,25 +121,24 @@ void VersionInfoFactory::ParseVersion (TiXmlElement* entry, VersionInfo* mem)
         throw Error::SymbolsXmlBadAttribute("os-type");
 
     string os = cstr_os;
-    mem->setVersion(cstr_name);
+    table->name = cstr_name;
 
     if(os == "windows")
     {
-        mem->setOS(OS_WINDOWS);
+        table->os = OS_WINDOWS;
     }
     else if(os == "linux")
     {
-        mem->setOS(OS_LINUX);
+        table->os = OS_LINUX;
     }
     else if(os == "darwin")
     {
-        mem->setOS(OS_APPLE);
+        table->os = OS_APPLE;
     }
     else
     {
         return; // ignore it if it's invalid
     }
-    mem->setBase(DEFAULT_BASE_ADDR);  // Memory.h
 
     // process additional entries
     //cout << "Entry " << cstr_version << " " <<  cstr_os << endl;
@@ -135,51 +165,257 @@ void VersionInfoFactory::ParseVersion (TiXmlElement* entry, VersionInfo* mem)
                 cerr << "Dummy symbol table entry: " << cstr_key << endl;
                 continue;
             }
-            if ((is_vtable && no_vtables) || (!is_vtable && no_globals))
-                continue;
-            uintptr_t addr;
-            if (cstr_value) {
-                if (sizeof(addr) == sizeof(unsigned long))
-                    addr = strtoul(cstr_value, 0, 0);
-                else
-                    addr = strtoull(cstr_value, 0, 0);
-            } else {
-                addr = (uintptr_t)DFHack::LookupPlugin(DFHack::GLOBAL_NAMES, cstr_mangled);
-                if (!addr)
-                    continue;
-                const char *cstr_offset = pMemEntry->Attribute("offset");
-                if (cstr_offset) {
-                    unsigned long offset = strtoul(cstr_offset, 0, 0);
-                    addr += offset;
-                }
-            }
-            if (is_vtable)
-                mem->setVTable(cstr_key, addr);
+            const char *cstr_offset = pMemEntry->Attribute("offset");
+
+            SymbolTable::Entry sym;
+            sym.is_vtable = is_vtable;
+            sym.key = cstr_key;
+            if (cstr_value)
+                sym.value = cstr_value;
             else
-                mem->setAddress(cstr_key, addr);
+                sym.mangled = cstr_mangled;
+            if (cstr_offset)
+                sym.offset = cstr_offset;
+            table->entries.push_back(sym);
         }
         else if (type == "md5-hash")
         {
             const char *cstr_value = pMemEntry->Attribute("value");
-            fprintf(stderr, "%s (%s): MD5: %s\n", cstr_name, cstr_os, cstr_value);
             if(!cstr_value)
                 throw Error::SymbolsXmlUnderspecifiedEntry(cstr_name);
-            mem->addMD5(cstr_value);
+            table->md5s.push_back(cstr_value);
         }
         else if (type == "binary-timestamp")
         {
             const char *cstr_value = pMemEntry->Attribute("value");
-            fprintf(stderr, "%s (%s): PE: %s\n", cstr_name, cstr_os, cstr_value);
             if(!cstr_value)
                 throw Error::SymbolsXmlUnderspecifiedEntry(cstr_name);
-            mem->addPE(strtol(cstr_value, 0, 16));
+            table->pes.push_back(strtol(cstr_value, 0, 16));
         }
     } // for
 } // method
 
+void VersionInfoFactory::BuildVersion (const SymbolTable &table, VersionInfo* mem)
+{
+    bool no_vtables = getenv("DFHACK_NO_VTABLES");
+    bool no_globals = getenv("DFHACK_NO_GLOBALS");
+    const char *cstr_name = table.name.c_str();
+    const char *cstr_os = table.os == OS_WINDOWS ? "windows" :
+                          table.os == OS_LINUX ? "linux" : "darwin";
+
+    mem->setVersion(table.name);
+    if (table.os == OS_BAD)
+        return;
+
+    mem->setOS(table.os);
+    mem->setBase(DEFAULT_BASE_ADDR);  // Memory.h
+
+    for (const auto &md5 : table.md5s)
+    {
+        fprintf(stderr, "%s (%s): MD5: %s\n", cstr_name, cstr_os, md5.c_str());
+        mem->addMD5(md5);
+    }
+    for (uintptr_t pe : table.pes)
+    {
+        fprintf(stderr, "%s (%s): PE: %lx\n", cstr_name, cstr_os, (unsigned long)pe);
+        mem->addPE(pe);
+    }
+
+    for (const auto &sym : table.entries)
+    {
+        if ((sym.is_vtable && no_vtables) || (!sym.is_vtable && no_globals))
+            continue;
+        uintptr_t addr;
+        if (!sym.value.empty()) {
+            if (sizeof(addr) == sizeof(unsigned long))
+                addr = strtoul(sym.value.c_str(), 0, 0);
+            else
+                addr = strtoull(sym.value.c_str(), 0, 0);
+        } else {
+            addr = (uintptr_t)DFHack::LookupPlugin(DFHack::GLOBAL_NAMES, sym.mangled.c_str());
+            if (!addr)
+                continue;
+            if (!sym.offset.empty()) {
+                unsigned long offset = strtoul(sym.offset.c_str(), 0, 0);
+                addr += offset;
+            }
+        }
+        if (sym.is_vtable)
+            mem->setVTable(sym.key, addr);
+        else
+            mem->setAddress(sym.key, addr);
+    }
+}
+
+/*
+ * Symbol table cache: the table that matched the running executable,
+ * stored in a compact binary form together with the MD5 of symbols.xml.
+ */
+static const char symbols_cache_magic[] = "DFHack symbol cache v1";
+
+static void write_u32(ostream &out, uint32_t val)
+{
+    out.write((const char*)&val, sizeof(val));
+}
+
+static void write_str(ostream &out, const string &str)
+{
+    write_u32(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+static bool read_u32(istream &in, uint32_t *val)
+{
+    return bool(in.read((char*)val, sizeof(*val)));
+}
+
+static bool read_str(istream &in, string *str)
+{
+    uint32_t size;
+    if (!read_u32(in, &size) || size > (1 << 20))
+        return false;
+    str->resize(size);
+    return size == 0 || bool(in.read(&(*str)[0], size));
+}
+
+bool VersionInfoFactory::loadCache(const string &path, const string &md5)
+{
+    ifstream in(path, ios::binary);
+    if (!in)
+        return false;
+
+    string magic, cached_md5;
+    if (!read_str(in, &magic) || magic != symbols_cache_magic)
+        return false;
+    if (!read_str(in, &cached_md5) || cached_md5 != md5)
+        return false;
+
+    auto table = std::make_shared<SymbolTable>();
+    uint32_t os, count;
+    if (!read_str(in, &table->name) || !read_u32(in, &os) || os > OS_BAD)
+        return false;
+    table->os = (OSType)os;
+
+    if (!read_u32(in, &count))
+        return false;
+    table->md5s.resize(count);
+    for (auto &hash : table->md5s)
+        if (!read_str(in, &hash))
+            return false;
+
+    if (!read_u32(in, &count))
+        return false;
+    table->pes.resize(count);
+    for (auto &pe : table->pes)
+    {
+        uint32_t val;
+        if (!read_u32(in, &val))
+            return false;
+        pe = val;
+    }
+
+    if (!read_u32(in, &count))
+        return false;
+    table->entries.resize(count);
+    for (auto &sym : table->entries)
+    {
+        uint32_t is_vtable;
+        if (!read_u32(in, &is_vtable) || !read_str(in, &sym.key) ||
+            !read_str(in, &sym.value) || !read_str(in, &sym.mangled) ||
+            !read_str(in, &sym.offset))
+            return false;
+        sym.is_vtable = is_vtable != 0;
+    }
+
+    auto version = std::make_shared<VersionInfo>();
+    BuildVersion(*table, version.get());
+    versions.push_back(version);
+    tables.push_back(table);
+    return true;
+}
+
+void VersionInfoFactory::saveCache(const VersionInfo &identified) const
+{
+    if (from_cache || cache_path.empty() || xml_md5.empty())
+        return;
+
+    for (size_t i = 0; i < versions.size(); i++)
+    {
+        if (versions[i]->getVersion() != identified.getVersion() ||
+            versions[i]->getOS() != identified.getOS())
+            continue;
+
+        const SymbolTable &table = *tables[i];
+
+        string dir = cache_path.substr(0, cache_path.find_last_of("/\\"));
+        if (!Filesystem::isdir(dir))
+            Filesystem::mkdir(dir);
+
+        string tmp_path = cache_path + ".tmp";
+        {
+            ofstream out(tmp_path, ios::binary);
+            if (!out)
+                return;
+
+            write_str(out, symbols_cache_magic);
+            write_str(out, xml_md5);
+            write_str(out, table.name);
+            write_u32(out, table.os);
+            write_u32(out, table.md5s.size());
+            for (const auto &hash : table.md5s)
+                write_str(out, hash);
+            write_u32(out, table.pes.size());
+            for (uintptr_t pe : table.pes)
+                write_u32(out, pe);
+            write_u32(out, table.entries.size());
+            for (const auto &sym : table.entries)
+            {
+                write_u32(out, sym.is_vtable);
+                write_str(out, sym.key);
+                write_str(out, sym.value);
+                write_str(out, sym.mangled);
+                write_str(out, sym.offset);
+            }
+            if (!out.good())
+                return;
+        }
+
+        remove(cache_path.c_str());
+        rename(tmp_path.c_str(), cache_path.c_str());
+        return;
+    }
+}
+
 // load the XML file with offsets
-bool VersionInfoFactory::loadFile(string path_to_xml)
+bool VersionInfoFactory::loadFile(string path_to_xml, bool use_cache)
 {
+    // The cache lives in a cache/ directory next to symbols.xml
+    size_t sep = path_to_xml.find_last_of("/\\");
+    string dir = (sep == string::npos) ? "" : path_to_xml.substr(0, sep + 1);
+#ifdef _WIN32
+    cache_path = dir + "cache\\symbols.bin";
+#else
+    cache_path = dir + "cache/symbols.bin";
+#endif
+
+    md5wrapper md5;
+    uint32_t length;
+    xml_md5 = md5.getHashFromFile(path_to_xml, length);
+    if (xml_md5.size() != 32)
+        xml_md5.clear();
+
+    if (use_cache && !xml_md5.empty())
+    {
+        clear();
+        if (loadCache(cache_path, xml_md5))
+        {
+            from_cache = true;
+            std::cerr << "Loaded cached DF symbol table for " << versions[0]->getVersion() << std::endl;
+            return true;
+        }
+        clear();
+    }
+
     TiXmlDocument doc( path_to_xml.c_str() );
     std::cerr << "Loading " << path_to_xml << " ... ";
     //bool loadOkay = doc.LoadFile();
@@ -225,9 +461,12 @@ bool VersionInfoFactory::loadFile(string path_to_xml)
             const char *name = pMemInfo->Attribute("name");
             if(name)
             {
+                auto table = std::make_shared<SymbolTable>();
+                ParseVersion( pMemInfo , table.get() );
                 auto version = std::make_shared<VersionInfo>();
-                ParseVersion( pMemInfo , version.get() );
+                BuildVersion( *table, version.get() );
                 versions.push_back(version);
+                tables.push_back(table);
             }
         }
     }
@@ -108,6 +108,33 @@ namespace DFHack
         }
     };
 
+    // Time spent by DFHack in Core::Update, over the last FrameStats::WINDOW frames.
+    // All times are in microseconds.
+    struct FrameStats
+    {
+        enum Section {
+            STATE_CHECKS,   // doUpdate: viewscreen/world/map/pause checks and state change handlers
+            EVENT_MANAGER,
+            BUILDINGS,      // buildings_onUpdate
+            PLUGINS,        // plugin_onupdate handlers
+            LUA_TIMERS,
+            TOOLS,          // commands run while DF waits at the end of the frame
+            TOTAL,          // all of the above
+            FRAME,          // interval between two calls to Core::Update
+            NUM_SECTIONS
+        };
+        static const int WINDOW = 1000;
+        static const char *const section_names[NUM_SECTIONS];
+
+        struct Percentiles {
+            double p50, p95, p99, max, mean;
+        };
+
+        size_t samples;         // frames in the window
+        uint64_t total_frames;  // frames measured since startup
+        Percentiles section[NUM_SECTIONS];
+    };
+
     // Core is a singleton. Why? Because it is closely tied to SDL calls. It tracks the global state of DF.
     // There should never be more than one instance
     // Better than tracking some weird variables all over the place.
@@ -200,6 +227,9 @@ namespace DFHack
 
         PluginManager *getPluginManager() { return plug_mgr; }
 
+        /// get the rolling per-frame timing statistics
+        void getFrameStats(FrameStats *out);
+
         static void cheap_tokenise(std::string const& input, std::vector<std::string> &output);
 
     private:
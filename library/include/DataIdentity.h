@@ -134,6 +134,10 @@ namespace DFHack
 
         virtual bool lua_insert2(lua_State *state, int fname_idx, void *ptr, int idx, int val_index);
 
+        // Direct item access for native code that walks the container
+        int get_item_count(void *ptr) { return item_count(ptr, COUNT_READ); }
+        void *get_item_pointer(type_identity *item, void *ptr, int idx) { return item_pointer(item, ptr, idx); }
+
     protected:
         virtual int item_count(void *ptr, CountMode cnt) = 0;
         virtual void *item_pointer(type_identity *item, void *ptr, int idx) = 0;
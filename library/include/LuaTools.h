@@ -366,6 +366,70 @@ namespace DFHack {namespace Lua {
         DFHACK_EXPORT void Invoke(color_ostream &out, lua_State *state, void *key, int num_args);
     }
 
+    /**
+     * Load a script file as a function, like loadfile(path, 't', env).
+     * Compiled bytecode is cached by path, modification time and size,
+     * and optionally persisted under hack/cache/scripts. Pushes the
+     * function, or an error message if the result is not LUA_OK.
+     */
+    DFHACK_EXPORT int LoadScript(lua_State *state, const std::string &path, int env_idx = 0);
+
+    struct ScriptCacheStats {
+        size_t compiled;        // scripts parsed from source
+        size_t memory_hits;     // loaded from bytecode cached in memory
+        size_t disk_hits;       // loaded from bytecode cached on disk
+        double compile_ms;      // total time spent parsing sources
+        double cached_load_ms;  // total time spent loading cached bytecode
+    };
+
+    DFHACK_EXPORT ScriptCacheStats GetScriptCacheStats();
+    DFHACK_EXPORT void SetScriptCachePersistent(bool persistent);
+    /**
+     * Drop the in-memory cache; called when a world is unloaded, and
+     * available to Lua as dfhack.internal.clearScriptCache().
+     */
+    DFHACK_EXPORT void ClearScriptCache();
+
+    /**
+     * Native sampling profiler for Lua code running in the core context.
+     * All accesses must be done under CoreSuspender.
+     */
+    namespace Profiler {
+        /**
+         * Start sampling the Lua stack every 'period' VM instructions.
+         * If target is not empty, only samples taken within a Scope
+         * whose "kind:name" label starts with it are recorded.
+         */
+        DFHACK_EXPORT void Start(lua_State *state, int period = 1000,
+                                 const std::string &target = std::string());
+        DFHACK_EXPORT void Stop(lua_State *state);
+        DFHACK_EXPORT bool IsActive();
+        DFHACK_EXPORT void Reset();
+        DFHACK_EXPORT size_t GetSampleCount();
+
+        /**
+         * Write the samples as collapsed stacks: one line per distinct
+         * stack, with frames separated by ';' starting from the outermost,
+         * followed by the number of samples. This is the input format of
+         * flamegraph.pl and compatible tools.
+         */
+        DFHACK_EXPORT void Dump(std::ostream &out);
+
+        /**
+         * Marks native code that runs Lua, so that samples taken
+         * inside it are prefixed with a "[kind:name]" frame.
+         */
+        class DFHACK_EXPORT Scope {
+            bool pushed;
+        public:
+            Scope(const char *kind, const std::string &name);
+            ~Scope();
+        };
+
+        // Not exported; for use by coroutine resume helpers
+        void Attach(lua_State *thread);
+    }
+
     class StackUnwinder {
         lua_State *state;
         int top;
@@ -69,6 +69,21 @@ namespace LuaWrapper {
      */
     extern LuaToken DFHACK_PTR_IDTABLE_TOKEN;
 
+    /**
+     * Registry pkey: userdata holding the FieldCache of this state.
+     */
+    extern LuaToken DFHACK_FIELD_CACHE_TOKEN;
+
+    /**
+     * Registry pkey: set of field name strings referenced by the FieldCache.
+     */
+    extern LuaToken DFHACK_FIELD_NAMES_TOKEN;
+
+    /**
+     * Registry pkey: ring of recently pushed object references, indexed by hashed address.
+     */
+    extern LuaToken DFHACK_OBJ_CACHE_TOKEN;
+
 // Function registry names
 #define DFHACK_CHANGEERROR_NAME "DFHack::ChangeError"
 #define DFHACK_COMPARE_NAME "DFHack::ComparePtrs"
@@ -128,8 +143,41 @@ namespace LuaWrapper {
         void *ptr;
     };
 
+    /**
+     * Direct-mapped cache of resolved UPVAL_FIELDTABLE lookups. Keys are the
+     * field table and the name string, both compared by address; the name
+     * strings are kept alive in DFHACK_FIELD_NAMES_TOKEN, so an address
+     * can't be reused by a different string while the entry exists.
+     *
+     * The pointer to the cache lives in the lua_getextraspace area of the
+     * main thread, and is inherited by coroutines.
+     */
+    struct FieldCache {
+        static const unsigned SIZE = 512;
+
+        struct Entry {
+            const void *table;
+            const char *key;
+            void *field;
+        } entries[SIZE];
+
+        static unsigned hash(const void *table, const char *key) {
+            return unsigned((uintptr_t(table) >> 4) ^ (uintptr_t(key) >> 3)) & (SIZE-1);
+        }
+    };
+
+    inline FieldCache *get_field_cache(lua_State *state) {
+        return *(FieldCache**)lua_getextraspace(state);
+    }
+
+    /**
+     * Number of slots in DFHACK_OBJ_CACHE_TOKEN; must be a power of 2.
+     */
+    const unsigned OBJ_CACHE_SIZE = 256;
+
     /**
      * Push the pointer as DF object ref using metatable on the stack.
+     * A recently pushed ref with the same address and metatable is reused.
      */
     void push_object_ref(lua_State *state, void *ptr);
     void *get_object_ref(lua_State *state, int val_index);
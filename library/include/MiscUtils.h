@@ -381,6 +381,11 @@ DFHACK_EXPORT int random_int(int max);
  */
 DFHACK_EXPORT uint64_t GetTimeMs64();
 
+/**
+ * Fletcher-16 checksum, used to detect changed map block data.
+ */
+DFHACK_EXPORT uint16_t fletcher16(uint8_t const *data, size_t bytes);
+
 DFHACK_EXPORT std::string stl_sprintf(const char *fmt, ...) Wformat(printf,1,2);
 DFHACK_EXPORT std::string stl_vsprintf(const char *fmt, va_list args) Wformat(printf,1,0);
 
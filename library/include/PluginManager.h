@@ -29,6 +29,7 @@ distribution.
 #include "ColorText.h"
 #include "MiscUtils.h"
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -163,6 +164,9 @@ namespace DFHack
         bool load(color_ostream &out);
         bool unload(color_ostream &out);
         bool reload(color_ostream &out);
+        // If loading was deferred (see dfhack-config/lazy-plugins.txt), load now.
+        // Returns true if the plugin is loaded afterwards.
+        bool load_if_deferred(color_ostream &out);
 
         bool can_be_enabled() { return plugin_is_enabled != 0; }
         bool is_enabled() { return plugin_is_enabled && *plugin_is_enabled; }
@@ -209,6 +213,12 @@ namespace DFHack
         DFLibrary * plugin_lib;
         PluginManager * parent;
         plugin_state state;
+        bool deferred;
+
+        std::string manifest_path();
+        std::string manifest_fingerprint();
+        void write_manifest();
+        bool defer();
 
         struct LuaCommand;
         std::map<std::string, LuaCommand*> lua_commands;
@@ -279,6 +289,8 @@ namespace DFHack
     private:
         Core *core;
         bool addPlugin(std::string name);
+        std::set<std::string> lazyPlugins();
+        void prefetch(const std::vector<std::string> &names);
         tthread::recursive_mutex * plugin_mutex;
         tthread::mutex * cmdlist_mutex;
         std::map <std::string, Plugin*> command_map;
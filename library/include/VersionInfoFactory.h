@@ -26,6 +26,8 @@ distribution.
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Pragma.h"
 #include "Export.h"
@@ -39,15 +41,28 @@ namespace DFHack
         public:
             VersionInfoFactory();
             ~VersionInfoFactory();
-            bool loadFile( std::string path_to_xml);
+            // Loads symbols.xml. Unless use_cache is false, the single symbol
+            // table saved by saveCache() is used instead if the xml is unchanged.
+            bool loadFile( std::string path_to_xml, bool use_cache = true);
             bool isInErrorState() const {return error;};
+            bool isFromCache() const {return from_cache;};
+            // Store the symbol table matching the identified version
+            void saveCache(const VersionInfo &identified) const;
             std::shared_ptr<const VersionInfo> getVersionInfoByMD5(std::string md5string) const;
             std::shared_ptr<const VersionInfo> getVersionInfoByPETimestamp(uintptr_t timestamp) const;
             // trash existing list
             void clear();
         private:
+            struct SymbolTable;
             std::vector<std::shared_ptr<const VersionInfo>> versions;
-            void ParseVersion (TiXmlElement* version, VersionInfo* mem);
+            // unresolved contents of each entry in versions
+            std::vector<std::shared_ptr<const SymbolTable>> tables;
+            void ParseVersion (TiXmlElement* version, SymbolTable* table);
+            void BuildVersion (const SymbolTable &table, VersionInfo* mem);
+            bool loadCache(const std::string &cache_path, const std::string &xml_md5);
+            std::string cache_path;
+            std::string xml_md5;
             bool error;
+            bool from_cache;
     };
 }
@@ -175,11 +175,14 @@ DFHACK_EXPORT bool remove(MapExtras::MapCache &mc, df::item *item, bool no_uncat
 /// Detaches the items from its current location and turns it into a projectile
 DFHACK_EXPORT df::proj_itemst *makeProjectile(MapExtras::MapCache &mc, df::item *item);
 
-/// Gets value of base-quality item with specified type and material
+/// Gets value of base-quality item with specified type and material.
+/// Results are cached until the world is unloaded.
 DFHACK_EXPORT int getItemBaseValue(int16_t item_type, int16_t item_subtype, int16_t mat_type, int32_t mat_subtype);
 
 /// Gets the value of a specific item, ignoring civ values and trade agreements
 DFHACK_EXPORT int getValue(df::item *item);
+/// Computes getValue for each item; NULL entries get a value of 0
+DFHACK_EXPORT void getValues(const std::vector<df::item*> &items, std::vector<int> *values);
 
 DFHACK_EXPORT int32_t createItem(df::item_type type, int16_t item_subtype, int16_t mat_type, int32_t mat_index, df::unit* creator);
 
@@ -668,7 +668,7 @@ function dfhack.run_script_with_env(envVars, name, flags, ...)
         script_code = scripts[file].run
     else
         --reload
-        script_code, perr = loadfile(file, 't', env)
+        script_code, perr = internal.loadScript(file, env)
         if not script_code then
             error(perr)
         end
@@ -677,6 +677,9 @@ function dfhack.run_script_with_env(envVars, name, flags, ...)
     end
     scripts[file].env = env
     scripts[file].run = script_code
+    if dfhack.profiler and dfhack.profiler.isActive() then
+        return dfhack.profiler.call('script', name, script_code, ...), env
+    end
     return script_code(...), env
 end
 
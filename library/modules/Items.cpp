@@ -36,6 +36,7 @@ distribution.
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
 using namespace std;
 
 #include "ModuleFactory.h"
@@ -1039,7 +1040,7 @@ df::proj_itemst *Items::makeProjectile(MapExtras::MapCache &mc, df::item *item)
     return proj;
 }
 
-int Items::getItemBaseValue(int16_t item_type, int16_t item_subtype, int16_t mat_type, int32_t mat_subtype)
+static int computeItemBaseValue(int16_t item_type, int16_t item_subtype, int16_t mat_type, int32_t mat_subtype)
 {
     int value = 0;
     switch (item_type)
@@ -1283,6 +1284,66 @@ int Items::getItemBaseValue(int16_t item_type, int16_t item_subtype, int16_t mat
     return value;
 }
 
+/*
+ * Base values only depend on the raws, so they are memoized per world.
+ */
+namespace {
+    struct BaseValueKey {
+        int16_t item_type, item_subtype, mat_type;
+        int32_t mat_subtype;
+
+        bool operator==(const BaseValueKey &other) const {
+            return item_type == other.item_type && item_subtype == other.item_subtype &&
+                   mat_type == other.mat_type && mat_subtype == other.mat_subtype;
+        }
+    };
+
+    struct BaseValueKeyHash {
+        size_t operator()(const BaseValueKey &key) const {
+            uint64_t packed = (uint64_t(uint16_t(key.item_type)) << 48) ^
+                              (uint64_t(uint16_t(key.item_subtype)) << 32) ^
+                              (uint64_t(uint16_t(key.mat_type)) << 16) ^
+                              uint64_t(uint32_t(key.mat_subtype)) * 0x9E3779B1u;
+            return std::hash<uint64_t>()(packed);
+        }
+    };
+
+    std::unordered_map<BaseValueKey, int, BaseValueKeyHash> base_value_cache;
+}
+
+void items_onStateChange(color_ostream &out, state_change_event event)
+{
+    switch (event) {
+    case SC_WORLD_LOADED:
+    case SC_WORLD_UNLOADED:
+        base_value_cache.clear();
+        break;
+    default:
+        break;
+    }
+}
+
+int Items::getItemBaseValue(int16_t item_type, int16_t item_subtype, int16_t mat_type, int32_t mat_subtype)
+{
+    BaseValueKey key = { item_type, item_subtype, mat_type, mat_subtype };
+    auto it = base_value_cache.find(key);
+    if (it != base_value_cache.end())
+        return it->second;
+
+    int value = computeItemBaseValue(item_type, item_subtype, mat_type, mat_subtype);
+    base_value_cache[key] = value;
+    return value;
+}
+
+void Items::getValues(const std::vector<df::item*> &items, std::vector<int> *values)
+{
+    CHECK_NULL_POINTER(values);
+
+    values->resize(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+        (*values)[i] = items[i] ? getValue(items[i]) : 0;
+}
+
 int Items::getValue(df::item *item)
 {
     CHECK_NULL_POINTER(item);
@@ -28,6 +28,7 @@ distribution.
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <cstring>
 using namespace std;
 
@@ -208,6 +209,87 @@ bool MaterialInfo::find(const std::vector<std::string> &items)
     return false;
 }
 
+/*
+ * Token -> index lookup tables for the raws, built on first use after
+ * a world is loaded and dropped when it is unloaded.
+ */
+namespace {
+    struct MaterialTokenIndex {
+        bool valid;
+        size_t num_inorganics, num_plants, num_creatures;
+        std::unordered_map<std::string, int> builtin;
+        std::unordered_map<std::string, int> inorganics;
+        std::unordered_map<std::string, int> plants;
+        std::unordered_map<std::string, int> creatures;
+
+        MaterialTokenIndex() : valid(false) {}
+
+        void clear()
+        {
+            valid = false;
+            builtin.clear();
+            inorganics.clear();
+            plants.clear();
+            creatures.clear();
+        }
+
+        void update();
+
+        static int lookup(const std::unordered_map<std::string, int> &map, const std::string &token)
+        {
+            auto it = map.find(token);
+            return it != map.end() ? it->second : -1;
+        }
+    };
+
+    MaterialTokenIndex token_index;
+}
+
+void MaterialTokenIndex::update()
+{
+    df::world_raws &raws = world->raws;
+
+    // Raws are only replaced between worlds, but be defensive about it
+    if (valid &&
+        num_inorganics == raws.inorganics.size() &&
+        num_plants == raws.plants.all.size() &&
+        num_creatures == raws.creatures.all.size())
+        return;
+
+    clear();
+
+    // emplace keeps the first entry for duplicate ids, like the linear scans did
+    for (int i = 0; i < NUM_BUILTIN; i++)
+    {
+        auto obj = raws.mat_table.builtin[i];
+        if (obj)
+            builtin.emplace(obj->id, i);
+    }
+    for (size_t i = 0; i < raws.inorganics.size(); i++)
+        inorganics.emplace(raws.inorganics[i]->id, i);
+    for (size_t i = 0; i < raws.plants.all.size(); i++)
+        plants.emplace(raws.plants.all[i]->id, i);
+    for (size_t i = 0; i < raws.creatures.all.size(); i++)
+        creatures.emplace(raws.creatures.all[i]->creature_id, i);
+
+    num_inorganics = raws.inorganics.size();
+    num_plants = raws.plants.all.size();
+    num_creatures = raws.creatures.all.size();
+    valid = true;
+}
+
+void materials_onStateChange(color_ostream &out, state_change_event event)
+{
+    switch (event) {
+    case SC_WORLD_LOADED:
+    case SC_WORLD_UNLOADED:
+        token_index.clear();
+        break;
+    default:
+        break;
+    }
+}
+
 bool MaterialInfo::findBuiltin(const std::string &token)
 {
     if (token.empty())
@@ -218,13 +300,10 @@ bool MaterialInfo::findBuiltin(const std::string &token)
         return true;
     }
 
-    df::world_raws &raws = world->raws;
-    for (int i = 0; i < NUM_BUILTIN; i++)
-    {
-        auto obj = raws.mat_table.builtin[i];
-        if (obj && obj->id == token)
-            return decode(i, -1);
-    }
+    token_index.update();
+    int i = token_index.lookup(token_index.builtin, token);
+    if (i >= 0)
+        return decode(i, -1);
     return decode(-1);
 }
 
@@ -238,13 +317,10 @@ bool MaterialInfo::findInorganic(const std::string &token)
         return true;
     }
 
-    df::world_raws &raws = world->raws;
-    for (size_t i = 0; i < raws.inorganics.size(); i++)
-    {
-        df::inorganic_raw *p = raws.inorganics[i];
-        if (p->id == token)
-            return decode(0, i);
-    }
+    token_index.update();
+    int i = token_index.lookup(token_index.inorganics, token);
+    if (i >= 0)
+        return decode(0, i);
     return decode(-1);
 }
 
@@ -252,12 +328,11 @@ bool MaterialInfo::findPlant(const std::string &token, const std::string &subtok
 {
     if (token.empty())
         return decode(-1);
-    df::world_raws &raws = world->raws;
-    for (size_t i = 0; i < raws.plants.all.size(); i++)
+    token_index.update();
+    int i = token_index.lookup(token_index.plants, token);
+    if (i >= 0)
     {
-        df::plant_raw *p = raws.plants.all[i];
-        if (p->id != token)
-            continue;
+        df::plant_raw *p = world->raws.plants.all[i];
 
         // As a special exception, return the structural material with empty subtoken
         if (subtoken.empty())
@@ -266,8 +341,6 @@ bool MaterialInfo::findPlant(const std::string &token, const std::string &subtok
         for (size_t j = 0; j < p->material.size(); j++)
             if (p->material[j]->id == subtoken)
                 return decode(PLANT_BASE+j, i);
-
-        break;
     }
     return decode(-1);
 }
@@ -276,18 +349,15 @@ bool MaterialInfo::findCreature(const std::string &token, const std::string &sub
 {
     if (token.empty() || subtoken.empty())
         return decode(-1);
-    df::world_raws &raws = world->raws;
-    for (size_t i = 0; i < raws.creatures.all.size(); i++)
+    token_index.update();
+    int i = token_index.lookup(token_index.creatures, token);
+    if (i >= 0)
     {
-        df::creature_raw *p = raws.creatures.all[i];
-        if (p->creature_id != token)
-            continue;
+        df::creature_raw *p = world->raws.creatures.all[i];
 
         for (size_t j = 0; j < p->material.size(); j++)
             if (p->material[j]->id == subtoken)
                 return decode(CREATURE_BASE+j, i);
-
-        break;
     }
     return decode(-1);
 }
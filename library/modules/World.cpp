@@ -27,6 +27,9 @@ distribution.
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
 #include <cstring>
 using namespace std;
 
@@ -56,9 +59,73 @@ using namespace df::enums;
 
 using df::global::world;
 
-static int next_persistent_id = 0;
-static std::multimap<std::string, int> persistent_index;
-typedef std::pair<std::string, int> T_persistent_item;
+namespace {
+    /*
+     * In-memory index of the persistent entries. The entries themselves
+     * live in fake historical figures, so they are written and discarded
+     * together with the rest of the save.
+     */
+    struct PersistentIndex {
+        int next_id;
+        // key -> entry ids, in creation order
+        std::unordered_map<std::string, std::vector<int> > by_key;
+        // sorted keys, for prefix queries
+        std::set<std::string> keys;
+        // entry id -> storage
+        std::unordered_map<int, df::historical_figure*> by_id;
+
+        PersistentIndex() : next_id(0) {}
+
+        void clear()
+        {
+            next_id = 0;
+            by_key.clear();
+            keys.clear();
+            by_id.clear();
+        }
+
+        void insert(df::historical_figure *hfig)
+        {
+            const std::string &key = hfig->name.first_name;
+            auto &ids = by_key[key];
+            if (ids.empty())
+                keys.insert(key);
+            ids.push_back(-hfig->id);
+            by_id[-hfig->id] = hfig;
+        }
+
+        bool erase(const std::string &key, int id)
+        {
+            auto it = by_key.find(key);
+            if (it == by_key.end())
+                return false;
+
+            auto &ids = it->second;
+            auto pos = std::find(ids.begin(), ids.end(), id);
+            if (pos == ids.end())
+                return false;
+
+            ids.erase(pos);
+            if (ids.empty())
+            {
+                keys.erase(key);
+                by_key.erase(it);
+            }
+            by_id.erase(id);
+            return true;
+        }
+
+        df::historical_figure *find(int id)
+        {
+            auto it = by_id.find(id);
+            return it != by_id.end() ? it->second : NULL;
+        }
+
+        void collect(std::vector<PersistentDataItem> *vec, const std::string &key);
+    };
+
+    PersistentIndex persistent_index;
+}
 
 bool World::ReadPauseState()
 {
@@ -221,9 +288,22 @@ struct hide_fake_histfigs_hook : df::viewscreen_legendsst {
 
 IMPLEMENT_VMETHOD_INTERPOSE_PRIO(hide_fake_histfigs_hook, feed, -10000);
 
+void PersistentIndex::collect(std::vector<PersistentDataItem> *vec, const std::string &key)
+{
+    auto it = by_key.find(key);
+    if (it == by_key.end())
+        return;
+
+    for (int id : it->second)
+    {
+        auto hfig = by_id[id];
+        if (hfig->name.has_name)
+            vec->push_back(dataFromHFig(hfig));
+    }
+}
+
 void World::ClearPersistentCache()
 {
-    next_persistent_id = 0;
     persistent_index.clear();
 
     INTERPOSE_HOOK(hide_fake_histfigs_hook, feed).apply(Core::getInstance().isWorldLoaded());
@@ -233,7 +313,7 @@ static bool BuildPersistentCache()
 {
     if (in_export_xml)
         return false;
-    if (next_persistent_id)
+    if (persistent_index.next_id)
         return true;
     if (!Core::getInstance().isWorldLoaded())
         return false;
@@ -241,20 +321,18 @@ static bool BuildPersistentCache()
     std::vector<df::historical_figure*> &hfvec = df::historical_figure::get_vector();
 
     // Determine the next entry id as min(-100, lowest_id-1)
-    next_persistent_id = -100;
+    persistent_index.next_id = -100;
 
     if (hfvec.size() > 0 && hfvec[0]->id <= -100)
-        next_persistent_id = hfvec[0]->id-1;
+        persistent_index.next_id = hfvec[0]->id-1;
 
     // Add the entries to the lookup table
-    persistent_index.clear();
-
     for (size_t i = 0; i < hfvec.size() && hfvec[i]->id <= -100; i++)
     {
         if (!hfvec[i]->name.has_name || hfvec[i]->name.first_name.empty())
             continue;
 
-        persistent_index.insert(T_persistent_item(hfvec[i]->name.first_name, -hfvec[i]->id));
+        persistent_index.insert(hfvec[i]);
     }
 
     return true;
@@ -268,18 +346,18 @@ PersistentDataItem World::AddPersistentData(const std::string &key)
     std::vector<df::historical_figure*> &hfvec = df::historical_figure::get_vector();
 
     df::historical_figure *hfig = new df::historical_figure();
-    hfig->id = next_persistent_id;
+    hfig->id = persistent_index.next_id;
     hfig->name.has_name = true;
     hfig->name.first_name = key;
     memset(hfig->name.words, 0xFF, sizeof(hfig->name.words));
 
     if (!hfvec.empty())
         hfig->id = std::min(hfig->id, hfvec[0]->id-1);
-    next_persistent_id = hfig->id-1;
+    persistent_index.next_id = hfig->id-1;
 
     hfvec.insert(hfvec.begin(), hfig);
 
-    persistent_index.insert(T_persistent_item(key, -hfig->id));
+    persistent_index.insert(hfig);
 
     return dataFromHFig(hfig);
 }
@@ -289,9 +367,9 @@ PersistentDataItem World::GetPersistentData(const std::string &key)
     if (!BuildPersistentCache())
         return PersistentDataItem();
 
-    auto it = persistent_index.find(key);
-    if (it != persistent_index.end())
-        return GetPersistentData(it->second);
+    auto it = persistent_index.by_key.find(key);
+    if (it != persistent_index.by_key.end())
+        return GetPersistentData(it->second.front());
 
     return PersistentDataItem();
 }
@@ -300,8 +378,10 @@ PersistentDataItem World::GetPersistentData(int entry_id)
 {
     if (entry_id < 100)
         return PersistentDataItem();
+    if (!BuildPersistentCache())
+        return PersistentDataItem();
 
-    auto hfig = df::historical_figure::find(-entry_id);
+    auto hfig = persistent_index.find(entry_id);
     if (hfig && hfig->name.has_name)
         return dataFromHFig(hfig);
 
@@ -330,33 +410,28 @@ void World::GetPersistentData(std::vector<PersistentDataItem> *vec, const std::s
     if (!BuildPersistentCache())
         return;
 
-    auto eqrange = persistent_index.equal_range(key);
-
-    if (prefix)
+    if (!prefix)
     {
-        if (key.empty())
-        {
-            eqrange.first = persistent_index.begin();
-            eqrange.second = persistent_index.end();
-        }
-        else
-        {
-            std::string bound = key;
-            if (bound[bound.size()-1] != '/')
-                bound += "/";
-            eqrange.first = persistent_index.lower_bound(bound);
-
-            bound[bound.size()-1]++;
-            eqrange.second = persistent_index.lower_bound(bound);
-        }
+        persistent_index.collect(vec, key);
+        return;
     }
 
-    for (auto it = eqrange.first; it != eqrange.second; ++it)
+    auto &keys = persistent_index.keys;
+    auto begin = keys.begin(), end = keys.end();
+
+    if (!key.empty())
     {
-        auto hfig = df::historical_figure::find(-it->second);
-        if (hfig && hfig->name.has_name)
-            vec->push_back(dataFromHFig(hfig));
+        std::string bound = key;
+        if (bound[bound.size()-1] != '/')
+            bound += "/";
+        begin = keys.lower_bound(bound);
+
+        bound[bound.size()-1]++;
+        end = keys.lower_bound(bound);
     }
+
+    for (auto it = begin; it != end; ++it)
+        persistent_index.collect(vec, *it);
 }
 
 bool World::DeletePersistentData(const PersistentDataItem &item)
@@ -367,30 +442,19 @@ bool World::DeletePersistentData(const PersistentDataItem &item)
     if (!BuildPersistentCache())
         return false;
 
-    std::vector<df::historical_figure*> &hfvec = df::historical_figure::get_vector();
-
-    auto eqrange = persistent_index.equal_range(item.key());
-
-    for (auto it2 = eqrange.first; it2 != eqrange.second; )
-    {
-        auto it = it2; ++it2;
-
-        if (it->second != -id)
-            continue;
-
-        persistent_index.erase(it);
+    if (!persistent_index.erase(item.key(), -id))
+        return false;
 
-        int idx = binsearch_index(hfvec, id);
+    std::vector<df::historical_figure*> &hfvec = df::historical_figure::get_vector();
 
-        if (idx >= 0) {
-            delete hfvec[idx];
-            hfvec.erase(hfvec.begin()+idx);
-        }
+    int idx = binsearch_index(hfvec, id);
 
-        return true;
+    if (idx >= 0) {
+        delete hfvec[idx];
+        hfvec.erase(hfvec.begin()+idx);
     }
 
-    return false;
+    return true;
 }
 
 df::tile_bitmask *World::getPersistentTilemask(const PersistentDataItem &item, df::map_block *block, bool create)
@@ -779,6 +779,58 @@ struct values_sorter
     std::vector<int> & values;
 };
 
+/*
+ * Skill level and experience of every dwarf in the skill used by every
+ * labor. Built in one pass over each dwarf's skill list per cycle, and
+ * stored labor-major so that assign_labor reads one contiguous row.
+ */
+struct labor_skill_matrix
+{
+    size_t n_dwarfs;
+    std::vector<int> level;
+    std::vector<int> experience;
+
+    void build(const std::vector<df::unit *>& dwarfs)
+    {
+        static std::vector<std::vector<df::unit_labor> > skill_labors;
+        if (skill_labors.empty())
+        {
+            skill_labors.resize(ENUM_LAST_ITEM(job_skill) + 1);
+            FOR_ENUM_ITEMS(unit_labor, labor)
+            {
+                if (labor != unit_labor::NONE && labor_to_skill[labor] != job_skill::NONE)
+                    skill_labors[labor_to_skill[labor]].push_back(labor);
+            }
+        }
+
+        n_dwarfs = dwarfs.size();
+        level.assign((ENUM_LAST_ITEM(unit_labor) + 1) * n_dwarfs, 0);
+        experience.assign(level.size(), 0);
+
+        for (size_t dwarf = 0; dwarf < n_dwarfs; dwarf++)
+        {
+            if (dwarfs[dwarf]->status.souls.empty())
+                continue;
+
+            // backwards, so that the first entry for a skill wins
+            auto &skills = dwarfs[dwarf]->status.souls[0]->skills;
+            for (auto s = skills.rbegin(); s != skills.rend(); ++s)
+            {
+                if ((*s)->id < 0 || size_t((*s)->id) >= skill_labors.size())
+                    continue;
+                for (auto labor : skill_labors[(*s)->id])
+                {
+                    level[labor * n_dwarfs + dwarf] = (*s)->rating;
+                    experience[labor * n_dwarfs + dwarf] = (*s)->experience;
+                }
+            }
+        }
+    }
+
+    const int *level_row(df::unit_labor labor) const { return &level[labor * n_dwarfs]; }
+    const int *experience_row(df::unit_labor labor) const { return &experience[labor * n_dwarfs]; }
+};
+
 
 static void assign_labor(unit_labor::unit_labor labor,
     int n_dwarfs,
@@ -787,6 +839,7 @@ static void assign_labor(unit_labor::unit_labor labor,
     std::vector<df::unit *>& dwarfs,
     bool has_butchers,
     bool has_fishery,
+    const labor_skill_matrix& skills,
     color_ostream& out)
 {
     df::job_skill skill = labor_to_skill[labor];
@@ -794,16 +847,17 @@ static void assign_labor(unit_labor::unit_labor labor,
         if (labor_infos[labor].mode() != AUTOMATIC)
             return;
 
-        int best_dwarf = 0;
-        int best_value = -10000;
         int best_skill = 0;
 
         std::vector<int> values(n_dwarfs);
         std::vector<int> candidates;
-        std::map<int, int> dwarf_skill;
-        std::map<int, int> dwarf_skillxp;
+        std::vector<int> dwarf_skill(n_dwarfs, 0);
+        std::vector<int> dwarf_skillxp(n_dwarfs, 0);
         std::vector<bool> previously_enabled(n_dwarfs);
 
+        const int *skill_levels = skills.level_row(labor);
+        const int *skill_experiences = skills.experience_row(labor);
+
         auto mode = labor_infos[labor].mode();
 
         // Find candidate dwarfs, and calculate a preference value for each dwarf
@@ -825,18 +879,8 @@ static void assign_labor(unit_labor::unit_labor labor,
 
             if (skill != job_skill::NONE)
             {
-                int skill_level = 0;
-                int skill_experience = 0;
-
-                for (auto s = dwarfs[dwarf]->status.souls[0]->skills.begin(); s < dwarfs[dwarf]->status.souls[0]->skills.end(); s++)
-                {
-                    if ((*s)->id == skill)
-                    {
-                        skill_level = (*s)->rating;
-                        skill_experience = (*s)->experience;
-                        break;
-                    }
-                }
+                int skill_level = skill_levels[dwarf];
+                int skill_experience = skill_experiences[dwarf];
 
                 dwarf_skill[dwarf] = skill_level;
                 dwarf_skillxp[dwarf] = skill_experience;
@@ -851,10 +895,6 @@ static void assign_labor(unit_labor::unit_labor labor,
                 if (skill_level >= 15)
                     value += 1000 * (skill_level - 14);
             }
-            else
-            {
-                dwarf_skill[dwarf] = 0;
-            }
 
             if (dwarfs[dwarf]->status.labors[labor])
             {
@@ -879,8 +919,8 @@ static void assign_labor(unit_labor::unit_labor labor,
         int pool = labor_infos[labor].talent_pool();
         if (pool < 200 && candidates.size() > 1 && abs(pool) < candidates.size())
         {
-            // Sort in descending order
-            std::sort(candidates.begin(), candidates.end(), [&](const int lhs, const int rhs) -> bool {
+            // Descending order (ascending for a negative pool)
+            auto talent_order = [&](const int lhs, const int rhs) -> bool {
                 if (dwarf_skill[lhs] == dwarf_skill[rhs])
                     if (pool > 0)
                         return dwarf_skillxp[lhs] > dwarf_skillxp[rhs];
@@ -891,11 +931,12 @@ static void assign_labor(unit_labor::unit_labor labor,
                         return dwarf_skill[lhs] > dwarf_skill[rhs];
                     else
                         return dwarf_skill[lhs] < dwarf_skill[rhs];
-            });
+            };
 
             // Check if all dwarves have equivalent skills, usually zero
-            int first_dwarf = candidates[0];
-            int last_dwarf = candidates[candidates.size() - 1];
+            auto range = std::minmax_element(candidates.begin(), candidates.end(), talent_order);
+            int first_dwarf = *range.first;
+            int last_dwarf = *range.second;
             if (dwarf_skill[first_dwarf] == dwarf_skill[last_dwarf] &&
                 dwarf_skillxp[first_dwarf] == dwarf_skillxp[last_dwarf])
             {
@@ -904,13 +945,15 @@ static void assign_labor(unit_labor::unit_labor labor,
             else
             {
                 // Trim down to our top (or not) talents
+                std::nth_element(candidates.begin(), candidates.begin() + abs(pool), candidates.end(), talent_order);
                 candidates.resize(abs(pool));
             }
         }
 
-        // Sort candidates by preference value
+        // Candidates are ordered by preference value lazily, a chunk at a time,
+        // since the loop below usually stops long before the end of the list
         values_sorter ivs(values);
-        std::sort(candidates.begin(), candidates.end(), ivs);
+        size_t sorted_candidates = 0;
 
         // Disable the labor on everyone
         for (int dwarf = 0; dwarf < n_dwarfs; dwarf++)
@@ -962,6 +1005,12 @@ static void assign_labor(unit_labor::unit_labor labor,
          */
         for (size_t i = 0; i < candidates.size() && labor_infos[labor].active_dwarfs < max_dwarfs; i++)
         {
+            if (i == sorted_candidates)
+            {
+                sorted_candidates = std::min(candidates.size(), i + std::max(size_t(8), size_t(max_dwarfs) * 2));
+                std::partial_sort(candidates.begin() + i, candidates.begin() + sorted_candidates, candidates.end(), ivs);
+            }
+
             int dwarf = candidates[i];
 
             if (dwarf_info[dwarf].trader && trader_requested)
@@ -1275,11 +1324,14 @@ DFhackCExport command_result plugin_onupdate ( color_ostream &out )
 
     // Handle all skills except those marked HAULERS
 
+    static labor_skill_matrix skills;
+    skills.build(dwarfs);
+
     for (auto lp = labors.begin(); lp != labors.end(); ++lp)
     {
         auto labor = *lp;
 
-        assign_labor(labor, n_dwarfs, dwarf_info, trader_requested, dwarfs, has_butchers, has_fishery, out);
+        assign_labor(labor, n_dwarfs, dwarf_info, trader_requested, dwarfs, has_butchers, has_fishery, skills, out);
     }
 
     // Set about 1/3 of the dwarfs as haulers. The haulers have all HAULER labors enabled. Having a lot of haulers helps
@@ -0,0 +1,106 @@
+// Timing harness shared by the dfhack-bench runner and the in-game bench
+// plugin, so that both report results in the same JSON format.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "json/json.h"
+
+namespace bench
+{
+    // Runs the benchmark once. Returns the number of items processed; the
+    // result is folded into checksum so that the compiler can't drop the work.
+    typedef std::function<size_t(uint64_t &checksum)> bench_fn;
+
+    struct Options
+    {
+        int iterations = 20;
+        std::string output_file;
+        std::vector<std::string> filter;
+
+        bool selected(const std::string &name) const
+        {
+            return filter.empty() || std::find(filter.begin(), filter.end(), name) != filter.end();
+        }
+    };
+
+    // Parses "[-n iterations] [-o file.json] [name...]"; false on bad usage.
+    inline bool parse_options(const std::vector<std::string> &args, Options &opts)
+    {
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            if (args[i] == "-n" && i + 1 < args.size())
+                opts.iterations = std::max(1, atoi(args[++i].c_str()));
+            else if (args[i] == "-o" && i + 1 < args.size())
+                opts.output_file = args[++i];
+            else if (args[i].empty() || args[i][0] == '-')
+                return false;
+            else
+                opts.filter.push_back(args[i]);
+        }
+        return true;
+    }
+
+    inline Json::Value skipped(const std::string &name, const std::string &reason)
+    {
+        Json::Value result(Json::objectValue);
+        result["name"] = name;
+        result["skipped"] = reason;
+        return result;
+    }
+
+    inline Json::Value run(const std::string &name, const bench_fn &fn, int iterations)
+    {
+        typedef std::chrono::steady_clock clock;
+
+        uint64_t checksum = 0;
+        size_t items = fn(checksum); // warm-up
+
+        std::vector<double> times;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto start = clock::now();
+            fn(checksum);
+            times.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+
+        double total = 0;
+        for (double t : times)
+            total += t;
+        double median = times[times.size() / 2];
+
+        Json::Value result(Json::objectValue);
+        result["name"] = name;
+        result["items"] = Json::UInt64(items);
+        result["iterations"] = iterations;
+        result["min_ms"] = times.front();
+        result["median_ms"] = median;
+        result["mean_ms"] = total / times.size();
+        result["max_ms"] = times.back();
+        result["ns_per_item"] = items ? median * 1e6 / items : 0.0;
+        result["checksum"] = Json::UInt64(checksum);
+        return result;
+    }
+
+    // One line per benchmark for the console
+    inline std::string summary(const Json::Value &result)
+    {
+        char buf[128];
+        if (result.isMember("skipped"))
+            snprintf(buf, sizeof(buf), "%-20s skipped: %s\n",
+                     result["name"].asCString(), result["skipped"].asCString());
+        else
+            snprintf(buf, sizeof(buf), "%-20s %10.3f ms median, %10.2f ns/item\n",
+                     result["name"].asCString(), result["median_ms"].asDouble(),
+                     result["ns_per_item"].asDouble());
+        return buf;
+    }
+}
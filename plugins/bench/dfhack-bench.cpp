@@ -0,0 +1,269 @@
+// Standalone micro-benchmarks for DFHack code paths that don't need a
+// running game, with JSON output so that CI can track them over time.
+//
+// All fixtures are synthetic and deterministic, so results are comparable
+// between runs and machines. Items can't be built here, as the virtual
+// methods of df::item subclasses are implemented by DF; those and the
+// benchmarks that need a loaded map are in the bench dev plugin instead.
+
+#include "DataDefs.h"
+#include "DFHackVersion.h"
+#include "MiscUtils.h"
+#include "TileTypes.h"
+
+#include "modules/Units.h"
+
+#include "df/map_block.h"
+#include "df/unit.h"
+
+#include "RemoteFortressReader.pb.h"
+
+#include "bench.h"
+
+#include <fstream>
+#include <iostream>
+
+using std::vector;
+using std::string;
+
+using namespace DFHack;
+using namespace df::enums;
+
+/*
+ * Fixtures
+ */
+
+// Deterministic, so that every run scans the same data
+struct FixtureRandom
+{
+    uint32_t state;
+    FixtureRandom(uint32_t seed) : state(seed) {}
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+struct Fixtures
+{
+    static const int BLOCKS_X = 12, BLOCKS_Y = 12, BLOCKS_Z = 16;
+    static const int UNITS = 5000;
+
+    vector<df::map_block*> blocks;
+    vector<df::unit*> units;
+
+    Fixtures()
+    {
+        FixtureRandom rng(12345);
+
+        static const df::tiletype terrain[] = {
+            tiletype::StoneWall, tiletype::StoneFloor1,
+            tiletype::SoilFloor1, tiletype::OpenSpace
+        };
+
+        for (int z = 0; z < BLOCKS_Z; z++)
+        for (int by = 0; by < BLOCKS_Y; by++)
+        for (int bx = 0; bx < BLOCKS_X; bx++)
+        {
+            auto block = new df::map_block();
+            block->map_pos = df::coord(bx * 16, by * 16, z);
+            for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+            {
+                uint32_t r = rng.next();
+                // lower levels are mostly rock, upper levels mostly open
+                int kind = (r % 100) < 100 * (BLOCKS_Z - z) / BLOCKS_Z ? r % 2 : 2 + r % 2;
+                block->tiletype[x][y] = terrain[kind];
+                auto &des = block->designation[x][y];
+                des.bits.hidden = (kind == 0);
+                if (kind != 0 && (r >> 8) % 16 == 0)
+                {
+                    des.bits.flow_size = 1 + (r >> 12) % 7;
+                    des.bits.liquid_type = ((r >> 16) % 4 == 0) ? tile_liquid::Magma : tile_liquid::Water;
+                }
+            }
+            blocks.push_back(block);
+        }
+
+        for (int i = 0; i < UNITS; i++)
+        {
+            uint32_t r = rng.next();
+            auto unit = new df::unit();
+            unit->id = i;
+            unit->race = r % 20;
+            unit->flags2.bits.killed = (r >> 8) % 8 == 0;
+            unit->flags3.bits.ghostly = (r >> 11) % 64 == 0;
+            unit->curse.add_tags1.bits.NOT_LIVING = (r >> 17) % 32 == 0;
+            switch ((r >> 22) % 16)
+            {
+            case 0: unit->profession = profession::TRAINED_WAR; break;
+            case 1: unit->profession2 = profession::TRAINED_HUNTER; break;
+            default: break;
+            }
+            units.push_back(unit);
+        }
+    }
+
+    ~Fixtures()
+    {
+        for (auto block : blocks)
+            delete block;
+        for (auto unit : units)
+            delete unit;
+    }
+};
+
+/*
+ * Benchmarks
+ */
+
+static size_t bench_tile_scan(Fixtures &fx, uint64_t &checksum)
+{
+    size_t walls = 0, liquid = 0, hidden = 0;
+    for (auto block : fx.blocks)
+    {
+        for (int x = 0; x < 16; x++)
+        for (int y = 0; y < 16; y++)
+        {
+            if (tileShape(block->tiletype[x][y]) == tiletype_shape::WALL)
+                walls++;
+            auto &des = block->designation[x][y];
+            if (des.bits.flow_size)
+                liquid++;
+            if (des.bits.hidden)
+                hidden++;
+        }
+    }
+    checksum += walls * 31 + liquid * 7 + hidden;
+    return fx.blocks.size() * 256;
+}
+
+static size_t bench_fletcher16(Fixtures &fx, uint64_t &checksum)
+{
+    for (auto block : fx.blocks)
+    {
+        checksum += fletcher16((uint8_t*)(block->tiletype), sizeof(block->tiletype));
+        checksum += fletcher16((uint8_t*)(block->designation), sizeof(block->designation));
+    }
+    return fx.blocks.size();
+}
+
+static size_t bench_block_serialize(Fixtures &fx, uint64_t &checksum)
+{
+    RemoteFortressReader::MapBlock net_block;
+    string buf;
+    for (auto block : fx.blocks)
+    {
+        net_block.Clear();
+        net_block.set_map_x(block->map_pos.x);
+        net_block.set_map_y(block->map_pos.y);
+        net_block.set_map_z(block->map_pos.z);
+        for (int yy = 0; yy < 16; yy++)
+        for (int xx = 0; xx < 16; xx++)
+        {
+            auto &des = block->designation[xx][yy];
+            bool magma = des.bits.liquid_type == tile_liquid::Magma;
+            net_block.add_tiles(block->tiletype[xx][yy]);
+            net_block.add_water(magma ? 0 : des.bits.flow_size);
+            net_block.add_magma(magma ? des.bits.flow_size : 0);
+            net_block.add_hidden(des.bits.hidden);
+        }
+        net_block.SerializeToString(&buf);
+        checksum += buf.size();
+    }
+    return fx.blocks.size();
+}
+
+// The Units predicates used by autobutcher and zone to pick animals
+static size_t bench_unit_predicates(Fixtures &fx, uint64_t &checksum)
+{
+    size_t alive = 0, dead = 0, trained = 0, adoptable = 0;
+    for (auto unit : fx.units)
+    {
+        if (Units::isDead(unit))
+            dead++;
+        if (!Units::isAlive(unit))
+            continue;
+        alive++;
+        if (Units::isWar(unit) || Units::isHunter(unit))
+            trained++;
+        else if (Units::isAvailableForAdoption(unit))
+            adoptable++;
+    }
+    checksum += alive * 131 + dead * 31 + trained * 7 + adoptable;
+    return fx.units.size();
+}
+
+struct Benchmark
+{
+    const char *name;
+    size_t (*fn)(Fixtures &fx, uint64_t &checksum);
+};
+
+static const Benchmark benchmarks[] = {
+    { "tile_scan", bench_tile_scan },
+    { "fletcher16", bench_fletcher16 },
+    { "block_serialize", bench_block_serialize },
+    { "unit_predicates", bench_unit_predicates },
+};
+
+int main(int argc, char **argv)
+{
+    bench::Options opts;
+    if (!bench::parse_options(vector<string>(argv + 1, argv + argc), opts))
+    {
+        std::cerr << "Usage: dfhack-bench [-n iterations] [-o file.json] [name...]" << std::endl
+                  << "Benchmarks:";
+        for (auto &bm : benchmarks)
+            std::cerr << " " << bm.name;
+        std::cerr << std::endl;
+        return 2;
+    }
+
+    for (auto &name : opts.filter)
+    {
+        auto it = std::find_if(std::begin(benchmarks), std::end(benchmarks),
+                               [&](const Benchmark &bm) { return name == bm.name; });
+        if (it == std::end(benchmarks))
+        {
+            std::cerr << "Unknown benchmark: " << name << std::endl;
+            return 2;
+        }
+    }
+
+    Fixtures fx;
+
+    Json::Value report(Json::objectValue);
+    report["dfhack_version"] = Version::dfhack_version();
+    report["git_commit"] = Version::git_commit();
+    report["benchmarks"] = Json::Value(Json::arrayValue);
+
+    for (auto &bm : benchmarks)
+    {
+        if (!opts.selected(bm.name))
+            continue;
+        auto fn = bm.fn;
+        auto result = bench::run(bm.name, [&fx, fn](uint64_t &checksum) { return fn(fx, checksum); },
+                                 opts.iterations);
+        std::cerr << bench::summary(result);
+        report["benchmarks"].append(result);
+    }
+
+    if (opts.output_file.empty())
+    {
+        std::cout << report << std::endl;
+        return 0;
+    }
+
+    std::ofstream file(opts.output_file);
+    file << report << std::endl;
+    if (!file.good())
+    {
+        std::cerr << "Could not write " << opts.output_file << std::endl;
+        return 1;
+    }
+    return 0;
+}
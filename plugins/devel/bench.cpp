@@ -0,0 +1,176 @@
+// Micro-benchmarks of the MapCache and item vectors, with JSON output.
+//
+// These need DF's geology and plant data, or items, whose virtual methods
+// are implemented by DF, so they run in-game on the loaded map. The
+// benchmarks that don't need a game are built into the standalone
+// dfhack-bench runner (plugins/bench), which shares the timing harness and
+// output format.
+
+#include "Core.h"
+#include "Console.h"
+#include "DataDefs.h"
+#include "Export.h"
+#include "PluginManager.h"
+#include "DFHackVersion.h"
+#include "VersionInfo.h"
+
+#include "modules/MapCache.h"
+#include "modules/Maps.h"
+
+#include "df/item.h"
+#include "df/map_block.h"
+#include "df/world.h"
+
+#include "../bench/bench.h"
+
+#include <fstream>
+#include <memory>
+
+using std::vector;
+using std::string;
+
+using namespace DFHack;
+using namespace df::enums;
+
+DFHACK_PLUGIN("bench");
+REQUIRE_GLOBAL(world);
+
+// First access to each block of the loaded map through a fresh MapCache,
+// which runs BlockInfo::prepare (veins, grass, plants, geology layers).
+static bench::bench_fn make_mapcache_prepare()
+{
+    return [](uint64_t &checksum) -> size_t {
+        MapExtras::MapCache mc;
+        for (auto block : world->map.map_blocks)
+        {
+            df::coord bpos(block->map_pos.x >> 4, block->map_pos.y >> 4, block->map_pos.z);
+            auto mblock = mc.BlockAt(bpos);
+            if (mblock)
+                checksum += mblock->baseMaterialAt(df::coord2d(0, 0)).mat_type;
+        }
+        return world->map.map_blocks.size();
+    };
+}
+
+// Per-tile reads through a MapCache whose blocks are already prepared
+static bench::bench_fn make_mapcache_access()
+{
+    auto mc = std::make_shared<MapExtras::MapCache>();
+    size_t count = std::min(world->map.map_blocks.size(), size_t(256));
+    vector<df::coord> origins;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto pos = world->map.map_blocks[i]->map_pos;
+        origins.push_back(pos);
+        mc->baseMaterialAt(pos);
+    }
+
+    return [mc, origins](uint64_t &checksum) -> size_t {
+        for (auto &origin : origins)
+        {
+            for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+            {
+                df::coord pos(origin.x + x, origin.y + y, origin.z);
+                checksum += mc->tiletypeAt(pos);
+                checksum += mc->baseMaterialAt(pos).mat_index;
+            }
+        }
+        return origins.size() * 256;
+    };
+}
+
+// The shape of the filters used by stocks, automelt and friends: virtual
+// getters and flags of every item on the map
+static bench::bench_fn make_item_scan()
+{
+    return [](uint64_t &checksum) -> size_t {
+        size_t found = 0, stacked = 0;
+        for (auto item : world->items.all)
+        {
+            if (item->flags.bits.garbage_collect || item->flags.bits.removed)
+                continue;
+            if (item->getType() == item_type::BAR && item->getMaterial() == 0)
+                found++;
+            stacked += item->getStackSize();
+            checksum += item->getMaterialIndex() + item->getQuality();
+        }
+        checksum += found * 31 + stacked;
+        return world->items.all.size();
+    };
+}
+
+struct Benchmark
+{
+    const char *name;
+    bench::bench_fn (*make)();
+};
+
+static const Benchmark benchmarks[] = {
+    { "mapcache_prepare", make_mapcache_prepare },
+    { "mapcache_access", make_mapcache_access },
+    { "item_scan", make_item_scan },
+};
+
+static command_result df_bench(color_ostream &out, vector<string> &parameters)
+{
+    bench::Options opts;
+    if (!bench::parse_options(parameters, opts))
+        return CR_WRONG_USAGE;
+
+    CoreSuspender suspend;
+
+    bool have_map = Maps::IsValid() && !world->map.map_blocks.empty();
+
+    Json::Value report(Json::objectValue);
+    report["dfhack_version"] = Version::dfhack_version();
+    report["git_commit"] = Version::git_commit();
+    report["df_version"] = Core::getInstance().vinfo->getVersion();
+    report["benchmarks"] = Json::Value(Json::arrayValue);
+
+    for (auto &bm : benchmarks)
+    {
+        if (!opts.selected(bm.name))
+            continue;
+        Json::Value result = have_map
+            ? bench::run(bm.name, bm.make(), opts.iterations)
+            : bench::skipped(bm.name, "no map loaded");
+        out << bench::summary(result);
+        report["benchmarks"].append(result);
+    }
+
+    if (opts.output_file.empty())
+    {
+        out << report << std::endl;
+        return CR_OK;
+    }
+
+    std::ofstream file(opts.output_file);
+    file << report << std::endl;
+    if (!file.good())
+    {
+        out.printerr("Could not write %s\n", opts.output_file.c_str());
+        return CR_FAILURE;
+    }
+    out.print("Results written to %s\n", opts.output_file.c_str());
+    return CR_OK;
+}
+
+DFhackCExport command_result plugin_init (color_ostream &out, std::vector <PluginCommand> &commands)
+{
+    commands.push_back(PluginCommand(
+        "bench", "Run micro-benchmarks of the MapCache and items on the loaded map.",
+        df_bench, false,
+        "  bench [-n iterations] [-o file.json] [name...]\n"
+        "    Runs the named benchmarks (default: all), and prints the timings\n"
+        "    as JSON or writes them to the given file.\n"
+        "    Benchmarks: mapcache_prepare, mapcache_access, item_scan\n"
+        "    Benchmarks that don't need a game are run by dfhack-bench.\n"
+    ));
+    return CR_OK;
+}
+
+DFhackCExport command_result plugin_shutdown (color_ostream &out)
+{
+    return CR_OK;
+}
@@ -48,7 +48,6 @@
 #include "df/viewscreen_unitst.h"
 #include "df/world_raws.h"
 
-using std::deque;
 
 DFHACK_PLUGIN("dwarfmonitor");
 DFHACK_PLUGIN_IS_ENABLED(is_enabled);
@@ -83,7 +82,6 @@ static bool monitor_jobs = false;
 static bool monitor_misery = true;
 static bool monitor_date = true;
 static bool monitor_weather = true;
-static map<df::unit *, deque<activity_type>> work_history;
 
 static int misery[] = { 0, 0, 0, 0, 0, 0, 0 };
 static bool misery_upto_date = false;
@@ -270,6 +268,178 @@ DFHACK_PLUGIN_LUA_COMMANDS {
 #define JOB_ANIMALS -20
 #define JOB_PRODUCTIVE -21
 
+// Activity samples of every monitored unit, kept as fixed-size ring
+// buffers in one flat array so that sampling doesn't allocate. For each
+// window length the stats screens can show, running per-unit and
+// fort-wide counts of every activity are updated as samples are pushed,
+// so the screens never have to walk the samples themselves.
+class activity_history
+{
+public:
+    static const int num_windows = max_history_days / min_window;
+
+    static int num_activities()
+    {
+        return ENUM_LAST_ITEM(job_type) + 1 - JOB_PRODUCTIVE;
+    }
+
+    static activity_type get_activity(int index)
+    {
+        return activity_type(index + JOB_PRODUCTIVE);
+    }
+
+    // Index of the activity in the count tables, or -1 if it isn't counted
+    static int get_index(activity_type activity)
+    {
+        int index = activity - JOB_PRODUCTIVE;
+        if (activity == JOB_UNKNOWN || index < 0 || index >= num_activities())
+            return -1;
+        return index;
+    }
+
+    static int get_window(size_t window_days)
+    {
+        int window = int(window_days / min_window) - 1;
+        return std::max(0, std::min(num_windows - 1, window));
+    }
+
+    void clear()
+    {
+        unit_slots.clear();
+        slot_units.clear();
+        slot_heads.clear();
+        free_slots.clear();
+        samples.clear();
+        counts.clear();
+        fort_counts.clear();
+    }
+
+    size_t size() const { return slot_units.size(); }
+
+    // Unit sampled into the slot, or NULL if the slot is free
+    df::unit *get_unit(size_t slot) const { return slot_units[slot]; }
+
+    size_t get_count(size_t slot, int window, int index) const
+    {
+        return counts[(slot * num_windows + window) * num_activities() + index];
+    }
+
+    size_t get_fort_count(int window, int index) const
+    {
+        return fort_counts[window * num_activities() + index];
+    }
+
+    void push(df::unit *unit, activity_type activity)
+    {
+        size_t slot = get_slot(unit);
+        size_t history = get_max_history();
+        activity_type *buffer = &samples[slot * history];
+        size_t head = slot_heads[slot];
+        int index = get_index(activity);
+
+        for (int window = 0; window < num_windows; window++)
+        {
+            uint16_t *unit_counts = &counts[(slot * num_windows + window) * num_activities()];
+            uint32_t *window_counts = &fort_counts[window * num_activities()];
+
+            // the sample that drops out of this window
+            int old_index = get_index(buffer[(head + history - window_length(window)) % history]);
+            if (old_index >= 0)
+            {
+                --unit_counts[old_index];
+                --window_counts[old_index];
+            }
+
+            if (index >= 0)
+            {
+                ++unit_counts[index];
+                ++window_counts[index];
+            }
+        }
+
+        buffer[head] = activity;
+        slot_heads[slot] = (head + 1) % history;
+    }
+
+    void forget(df::unit *unit)
+    {
+        auto it = unit_slots.find(unit);
+        if (it != unit_slots.end())
+            forget_slot(it->second);
+    }
+
+    void forget_slot(size_t slot)
+    {
+        df::unit *unit = slot_units[slot];
+        if (!unit)
+            return;
+
+        for (int window = 0; window < num_windows; window++)
+        {
+            uint16_t *unit_counts = &counts[(slot * num_windows + window) * num_activities()];
+            uint32_t *window_counts = &fort_counts[window * num_activities()];
+            for (int index = 0; index < num_activities(); index++)
+            {
+                window_counts[index] -= unit_counts[index];
+                unit_counts[index] = 0;
+            }
+        }
+
+        size_t history = get_max_history();
+        std::fill_n(samples.begin() + slot * history, history, activity_type(JOB_UNKNOWN));
+
+        unit_slots.erase(unit);
+        slot_units[slot] = NULL;
+        free_slots.push_back(slot);
+    }
+
+private:
+    map<df::unit *, size_t> unit_slots;
+    vector<df::unit *> slot_units;
+    vector<size_t> slot_heads;
+    vector<size_t> free_slots;
+    vector<activity_type> samples;
+    vector<uint16_t> counts;
+    vector<uint32_t> fort_counts;
+
+    static size_t window_length(int window)
+    {
+        return (window + 1) * min_window * ticks_per_day;
+    }
+
+    size_t get_slot(df::unit *unit)
+    {
+        auto it = unit_slots.find(unit);
+        if (it != unit_slots.end())
+            return it->second;
+
+        if (fort_counts.empty())
+            fort_counts.resize(num_windows * num_activities(), 0);
+
+        size_t slot;
+        if (!free_slots.empty())
+        {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        else
+        {
+            slot = slot_units.size();
+            slot_units.push_back(NULL);
+            slot_heads.push_back(0);
+            samples.resize(samples.size() + get_max_history(), JOB_UNKNOWN);
+            counts.resize(counts.size() + num_windows * num_activities(), 0);
+        }
+
+        slot_units[slot] = unit;
+        slot_heads[slot] = 0;
+        unit_slots[unit] = slot;
+        return slot;
+    }
+};
+
+static activity_history work_history;
+
 static map<activity_type, string> activity_labels;
 
 static string getActivityLabel(const activity_type activity)
@@ -322,31 +492,32 @@ public:
         dwarves_column.clear();
         dwarf_activity_values.clear();
 
-        for (auto it = work_history.begin(); it != work_history.end();)
+        int window = activity_history::get_window(window_days);
+        for (size_t slot = 0; slot < work_history.size(); slot++)
         {
-            auto unit = it->first;
+            auto unit = work_history.get_unit(slot);
+            if (!unit)
+                continue;
+
             if (!Units::isActive(unit))
             {
-                work_history.erase(it++);
+                work_history.forget_slot(slot);
                 continue;
             }
 
-            deque<activity_type> *work_list = &it->second;
-            ++it;
-
             size_t dwarf_total = 0;
-            dwarf_activity_values[unit] =  map<activity_type, size_t>();
-            size_t count = window_days * ticks_per_day;
-            for (auto entry = work_list->rbegin(); entry != work_list->rend() && count > 0; entry++, count--)
+            auto &values = dwarf_activity_values[unit];
+            for (int index = 0; index < activity_history::num_activities(); index++)
             {
-                if (*entry == JOB_UNKNOWN || *entry == job_type::DrinkBlood)
+                auto activity = activity_history::get_activity(index);
+                size_t count = work_history.get_count(slot, window, index);
+                if (!count || activity == job_type::DrinkBlood)
                     continue;
 
-                ++dwarf_total;
-                addDwarfActivity(unit, *entry);
+                dwarf_total += count;
+                values[activity] = count;
             }
 
-            auto &values = dwarf_activity_values[unit];
             for (auto it = values.begin(); it != values.end(); ++it)
                 it->second = getPercentage(it->second, dwarf_total);
 
@@ -388,14 +559,6 @@ public:
         dwarf_activity_column.setHighlight(0);
     }
 
-    void addDwarfActivity(df::unit *unit, const activity_type &activity)
-    {
-        if (dwarf_activity_values[unit].find(activity) == dwarf_activity_values[unit].end())
-            dwarf_activity_values[unit][activity] = 0;
-
-        dwarf_activity_values[unit][activity]++;
-    }
-
     string getActivityItem(activity_type activity, size_t value)
     {
         return pad_string(int_to_string(value), 3) + " " + getActivityLabel(activity);
@@ -532,6 +695,280 @@ private:
 };
 
 
+// Category shown on the fort stats screen for an activity; job types
+// that don't belong to any category are returned unchanged.
+static activity_type get_activity_category(const activity_type activity)
+{
+    if (activity < 0)
+        return activity;
+
+    activity_type category = activity;
+    switch (static_cast<df::job_type>(activity))
+    {
+    case job_type::Eat:
+    case job_type::Drink:
+    case job_type::Drink2:
+    case job_type::Sleep:
+    case job_type::AttendParty:
+    case job_type::Rest:
+    case job_type::CleanSelf:
+    case job_type::DrinkBlood:
+        category = JOB_LEISURE;
+        break;
+
+    case job_type::Kidnap:
+    case job_type::StartingFistFight:
+    case job_type::SeekInfant:
+    case job_type::SeekArtifact:
+    case job_type::GoShopping:
+    case job_type::GoShopping2:
+    case job_type::RecoverPet:
+    case job_type::CauseTrouble:
+    case job_type::ReportCrime:
+    case job_type::BeatCriminal:
+    case job_type::ExecuteCriminal:
+        category = JOB_UNPRODUCTIVE;
+        break;
+
+    case job_type::CarveUpwardStaircase:
+    case job_type::CarveDownwardStaircase:
+    case job_type::CarveUpDownStaircase:
+    case job_type::CarveRamp:
+    case job_type::DigChannel:
+    case job_type::Dig:
+    case job_type::CarveTrack:
+    case job_type::CarveFortification:
+        category = JOB_DESIGNATE;
+        break;
+
+    case job_type::StoreOwnedItem:
+    case job_type::PlaceItemInTomb:
+    case job_type::StoreItemInStockpile:
+    case job_type::StoreItemInBag:
+    case job_type::StoreItemInHospital:
+    case job_type::StoreWeapon:
+    case job_type::StoreArmor:
+    case job_type::StoreItemInBarrel:
+    case job_type::StoreItemInBin:
+    case job_type::BringItemToDepot:
+    case job_type::BringItemToShop:
+    case job_type::GetProvisions:
+    case job_type::FillWaterskin:
+    case job_type::FillWaterskin2:
+    case job_type::CheckChest:
+    case job_type::PickupEquipment:
+    case job_type::DumpItem:
+    case job_type::PushTrackVehicle:
+    case job_type::PlaceTrackVehicle:
+    case job_type::StoreItemInVehicle:
+        category = JOB_STORE_ITEM;
+        break;
+
+    case job_type::ConstructDoor:
+    case job_type::ConstructFloodgate:
+    case job_type::ConstructBed:
+    case job_type::ConstructThrone:
+    case job_type::ConstructCoffin:
+    case job_type::ConstructTable:
+    case job_type::ConstructChest:
+    case job_type::ConstructBin:
+    case job_type::ConstructArmorStand:
+    case job_type::ConstructWeaponRack:
+    case job_type::ConstructCabinet:
+    case job_type::ConstructStatue:
+    case job_type::ConstructBlocks:
+    case job_type::MakeRawGlass:
+    case job_type::MakeCrafts:
+    case job_type::MintCoins:
+    case job_type::CutGems:
+    case job_type::CutGlass:
+    case job_type::EncrustWithGems:
+    case job_type::EncrustWithGlass:
+    case job_type::SmeltOre:
+    case job_type::MeltMetalObject:
+    case job_type::ExtractMetalStrands:
+    case job_type::MakeWeapon:
+    case job_type::ForgeAnvil:
+    case job_type::ConstructCatapultParts:
+    case job_type::ConstructBallistaParts:
+    case job_type::MakeArmor:
+    case job_type::MakeHelm:
+    case job_type::MakePants:
+    case job_type::StudWith:
+    case job_type::ProcessPlantsVial:
+    case job_type::ProcessPlantsBarrel:
+    case job_type::WeaveCloth:
+    case job_type::MakeGloves:
+    case job_type::MakeShoes:
+    case job_type::MakeShield:
+    case job_type::MakeCage:
+    case job_type::MakeChain:
+    case job_type::MakeFlask:
+    case job_type::MakeGoblet:
+    case job_type::MakeToy:
+    case job_type::MakeAnimalTrap:
+    case job_type::MakeBarrel:
+    case job_type::MakeBucket:
+    case job_type::MakeWindow:
+    case job_type::MakeTotem:
+    case job_type::MakeAmmo:
+    case job_type::DecorateWith:
+    case job_type::MakeBackpack:
+    case job_type::MakeQuiver:
+    case job_type::MakeBallistaArrowHead:
+    case job_type::AssembleSiegeAmmo:
+    case job_type::ConstructMechanisms:
+    case job_type::MakeTrapComponent:
+    case job_type::ExtractFromPlants:
+    case job_type::ExtractFromRawFish:
+    case job_type::ExtractFromLandAnimal:
+    case job_type::MakeCharcoal:
+    case job_type::MakeAsh:
+    case job_type::MakeLye:
+    case job_type::MakePotashFromLye:
+    case job_type::MakePotashFromAsh:
+    case job_type::DyeThread:
+    case job_type::DyeCloth:
+    case job_type::SewImage:
+    case job_type::MakePipeSection:
+    case job_type::ConstructHatchCover:
+    case job_type::ConstructGrate:
+    case job_type::ConstructQuern:
+    case job_type::ConstructMillstone:
+    case job_type::ConstructSplint:
+    case job_type::ConstructCrutch:
+    case job_type::ConstructTractionBench:
+    case job_type::CustomReaction:
+    case job_type::ConstructSlab:
+    case job_type::EngraveSlab:
+    case job_type::SpinThread:
+    case job_type::MakeTool:
+        category = JOB_MANUFACTURE;
+        break;
+
+    case job_type::DetailFloor:
+    case job_type::DetailWall:
+        category = JOB_DETAILING;
+        break;
+
+    case job_type::Hunt:
+    case job_type::ReturnKill:
+    case job_type::HuntVermin:
+    case job_type::GatherPlants:
+    case job_type::Fish:
+    case job_type::CatchLiveFish:
+    case job_type::BaitTrap:
+    case job_type::InstallColonyInHive:
+        category = JOB_HUNTING;
+        break;
+
+    case job_type::RemoveConstruction:
+    case job_type::DestroyBuilding:
+    case job_type::RemoveStairs:
+    case job_type::ConstructBuilding:
+        category = JOB_CONSTRUCTION;
+        break;
+
+    case job_type::FellTree:
+    case job_type::CollectWebs:
+    case job_type::CollectSand:
+    case job_type::DrainAquarium:
+    case job_type::FillAquarium:
+    case job_type::FillPond:
+    case job_type::CollectClay:
+        category = JOB_COLLECT;
+        break;
+
+    case job_type::TrainHuntingAnimal:
+    case job_type::TrainWarAnimal:
+    case job_type::CatchLiveLandAnimal:
+    case job_type::TameVermin:
+    case job_type::TameAnimal:
+    case job_type::ChainAnimal:
+    case job_type::UnchainAnimal:
+    case job_type::UnchainPet:
+    case job_type::ReleaseLargeCreature:
+    case job_type::ReleasePet:
+    case job_type::ReleaseSmallCreature:
+    case job_type::HandleSmallCreature:
+    case job_type::HandleLargeCreature:
+    case job_type::CageLargeCreature:
+    case job_type::CageSmallCreature:
+    case job_type::PitLargeAnimal:
+    case job_type::PitSmallAnimal:
+    case job_type::SlaughterAnimal:
+    case job_type::ShearCreature:
+    case job_type::PenLargeAnimal:
+    case job_type::PenSmallAnimal:
+    case job_type::TrainAnimal:
+        category = JOB_ANIMALS;
+        break;
+
+    case job_type::PlantSeeds:
+    case job_type::HarvestPlants:
+    case job_type::FertilizeField:
+        category = JOB_AGRICULTURE;
+        break;
+
+    case job_type::ButcherAnimal:
+    case job_type::PrepareRawFish:
+    case job_type::MillPlants:
+    case job_type::MilkCreature:
+    case job_type::MakeCheese:
+    case job_type::PrepareMeal:
+    case job_type::ProcessPlants:
+    case job_type::CollectHiveProducts:
+        category = JOB_FOOD_PROD;
+        break;
+
+    case job_type::LoadCatapult:
+    case job_type::LoadBallista:
+    case job_type::FireCatapult:
+    case job_type::FireBallista:
+        category = JOB_MILITARY;
+        break;
+
+    case job_type::LoadCageTrap:
+    case job_type::LoadStoneTrap:
+    case job_type::LoadWeaponTrap:
+    case job_type::CleanTrap:
+    case job_type::LinkBuildingToTrigger:
+    case job_type::PullLever:
+        category = JOB_MECHANICAL;
+        break;
+
+    case job_type::RecoverWounded:
+    case job_type::DiagnosePatient:
+    case job_type::ImmobilizeBreak:
+    case job_type::DressWound:
+    case job_type::CleanPatient:
+    case job_type::Surgery:
+    case job_type::Suture:
+    case job_type::SetBone:
+    case job_type::PlaceInTraction:
+    case job_type::GiveWater:
+    case job_type::GiveFood:
+    case job_type::GiveWater2:
+    case job_type::GiveFood2:
+    case job_type::BringCrutch:
+    case job_type::ApplyCast:
+        category = JOB_MEDICAL;
+        break;
+
+    case job_type::OperatePump:
+    case job_type::ManageWorkOrders:
+    case job_type::UpdateStockpileRecords:
+    case job_type::TradeAtDepot:
+        category = JOB_PRODUCTIVE;
+        break;
+
+    default:
+        break;
+    }
+
+    return category;
+}
+
 class ViewscreenFortStats : public dfhack_viewscreen
 {
 public:
@@ -567,310 +1004,43 @@ public:
         dwarf_activity_values.clear();
         category_breakdown.clear();
 
-        for (auto it = work_history.begin(); it != work_history.end();)
+        for (size_t slot = 0; slot < work_history.size(); slot++)
         {
-            auto unit = it->first;
-            if (!Units::isActive(unit))
-            {
-                work_history.erase(it++);
-                continue;
-            }
-
-            deque<activity_type> *work_list = &it->second;
-            ++it;
-
-            size_t count = window_days * ticks_per_day;
-            for (auto entry = work_list->rbegin(); entry != work_list->rend() && count > 0; entry++, count--)
-            {
-                if (*entry == JOB_UNKNOWN)
-                    continue;
-
-                ++fort_activity_count;
+            auto unit = work_history.get_unit(slot);
+            if (unit && !Units::isActive(unit))
+                work_history.forget_slot(slot);
+        }
 
-                auto real_activity = *entry;
-                if (real_activity < 0)
-                {
-                    addFortActivity(real_activity);
-                }
-                else
-                {
-                    auto activity = static_cast<df::job_type>(real_activity);
+        int window = activity_history::get_window(window_days);
+        for (int index = 0; index < activity_history::num_activities(); index++)
+        {
+            size_t count = work_history.get_fort_count(window, index);
+            if (!count)
+                continue;
 
-                    switch (activity)
-                    {
-                    case job_type::Eat:
-                    case job_type::Drink:
-                    case job_type::Drink2:
-                    case job_type::Sleep:
-                    case job_type::AttendParty:
-                    case job_type::Rest:
-                    case job_type::CleanSelf:
-                    case job_type::DrinkBlood:
-                        real_activity = JOB_LEISURE;
-                        break;
-
-                    case job_type::Kidnap:
-                    case job_type::StartingFistFight:
-                    case job_type::SeekInfant:
-                    case job_type::SeekArtifact:
-                    case job_type::GoShopping:
-                    case job_type::GoShopping2:
-                    case job_type::RecoverPet:
-                    case job_type::CauseTrouble:
-                    case job_type::ReportCrime:
-                    case job_type::BeatCriminal:
-                    case job_type::ExecuteCriminal:
-                        real_activity = JOB_UNPRODUCTIVE;
-                        break;
-
-                    case job_type::CarveUpwardStaircase:
-                    case job_type::CarveDownwardStaircase:
-                    case job_type::CarveUpDownStaircase:
-                    case job_type::CarveRamp:
-                    case job_type::DigChannel:
-                    case job_type::Dig:
-                    case job_type::CarveTrack:
-                    case job_type::CarveFortification:
-                        real_activity = JOB_DESIGNATE;
-                        break;
-
-                    case job_type::StoreOwnedItem:
-                    case job_type::PlaceItemInTomb:
-                    case job_type::StoreItemInStockpile:
-                    case job_type::StoreItemInBag:
-                    case job_type::StoreItemInHospital:
-                    case job_type::StoreWeapon:
-                    case job_type::StoreArmor:
-                    case job_type::StoreItemInBarrel:
-                    case job_type::StoreItemInBin:
-                    case job_type::BringItemToDepot:
-                    case job_type::BringItemToShop:
-                    case job_type::GetProvisions:
-                    case job_type::FillWaterskin:
-                    case job_type::FillWaterskin2:
-                    case job_type::CheckChest:
-                    case job_type::PickupEquipment:
-                    case job_type::DumpItem:
-                    case job_type::PushTrackVehicle:
-                    case job_type::PlaceTrackVehicle:
-                    case job_type::StoreItemInVehicle:
-                        real_activity = JOB_STORE_ITEM;
-                        break;
-
-                    case job_type::ConstructDoor:
-                    case job_type::ConstructFloodgate:
-                    case job_type::ConstructBed:
-                    case job_type::ConstructThrone:
-                    case job_type::ConstructCoffin:
-                    case job_type::ConstructTable:
-                    case job_type::ConstructChest:
-                    case job_type::ConstructBin:
-                    case job_type::ConstructArmorStand:
-                    case job_type::ConstructWeaponRack:
-                    case job_type::ConstructCabinet:
-                    case job_type::ConstructStatue:
-                    case job_type::ConstructBlocks:
-                    case job_type::MakeRawGlass:
-                    case job_type::MakeCrafts:
-                    case job_type::MintCoins:
-                    case job_type::CutGems:
-                    case job_type::CutGlass:
-                    case job_type::EncrustWithGems:
-                    case job_type::EncrustWithGlass:
-                    case job_type::SmeltOre:
-                    case job_type::MeltMetalObject:
-                    case job_type::ExtractMetalStrands:
-                    case job_type::MakeWeapon:
-                    case job_type::ForgeAnvil:
-                    case job_type::ConstructCatapultParts:
-                    case job_type::ConstructBallistaParts:
-                    case job_type::MakeArmor:
-                    case job_type::MakeHelm:
-                    case job_type::MakePants:
-                    case job_type::StudWith:
-                    case job_type::ProcessPlantsVial:
-                    case job_type::ProcessPlantsBarrel:
-                    case job_type::WeaveCloth:
-                    case job_type::MakeGloves:
-                    case job_type::MakeShoes:
-                    case job_type::MakeShield:
-                    case job_type::MakeCage:
-                    case job_type::MakeChain:
-                    case job_type::MakeFlask:
-                    case job_type::MakeGoblet:
-                    case job_type::MakeToy:
-                    case job_type::MakeAnimalTrap:
-                    case job_type::MakeBarrel:
-                    case job_type::MakeBucket:
-                    case job_type::MakeWindow:
-                    case job_type::MakeTotem:
-                    case job_type::MakeAmmo:
-                    case job_type::DecorateWith:
-                    case job_type::MakeBackpack:
-                    case job_type::MakeQuiver:
-                    case job_type::MakeBallistaArrowHead:
-                    case job_type::AssembleSiegeAmmo:
-                    case job_type::ConstructMechanisms:
-                    case job_type::MakeTrapComponent:
-                    case job_type::ExtractFromPlants:
-                    case job_type::ExtractFromRawFish:
-                    case job_type::ExtractFromLandAnimal:
-                    case job_type::MakeCharcoal:
-                    case job_type::MakeAsh:
-                    case job_type::MakeLye:
-                    case job_type::MakePotashFromLye:
-                    case job_type::MakePotashFromAsh:
-                    case job_type::DyeThread:
-                    case job_type::DyeCloth:
-                    case job_type::SewImage:
-                    case job_type::MakePipeSection:
-                    case job_type::ConstructHatchCover:
-                    case job_type::ConstructGrate:
-                    case job_type::ConstructQuern:
-                    case job_type::ConstructMillstone:
-                    case job_type::ConstructSplint:
-                    case job_type::ConstructCrutch:
-                    case job_type::ConstructTractionBench:
-                    case job_type::CustomReaction:
-                    case job_type::ConstructSlab:
-                    case job_type::EngraveSlab:
-                    case job_type::SpinThread:
-                    case job_type::MakeTool:
-                        real_activity = JOB_MANUFACTURE;
-                        break;
-
-                    case job_type::DetailFloor:
-                    case job_type::DetailWall:
-                        real_activity = JOB_DETAILING;
-                        break;
-
-                    case job_type::Hunt:
-                    case job_type::ReturnKill:
-                    case job_type::HuntVermin:
-                    case job_type::GatherPlants:
-                    case job_type::Fish:
-                    case job_type::CatchLiveFish:
-                    case job_type::BaitTrap:
-                    case job_type::InstallColonyInHive:
-                        real_activity = JOB_HUNTING;
-                        break;
-
-                    case job_type::RemoveConstruction:
-                    case job_type::DestroyBuilding:
-                    case job_type::RemoveStairs:
-                    case job_type::ConstructBuilding:
-                        real_activity = JOB_CONSTRUCTION;
-                        break;
-
-                    case job_type::FellTree:
-                    case job_type::CollectWebs:
-                    case job_type::CollectSand:
-                    case job_type::DrainAquarium:
-                    case job_type::FillAquarium:
-                    case job_type::FillPond:
-                    case job_type::CollectClay:
-                        real_activity = JOB_COLLECT;
-                        break;
-
-                    case job_type::TrainHuntingAnimal:
-                    case job_type::TrainWarAnimal:
-                    case job_type::CatchLiveLandAnimal:
-                    case job_type::TameVermin:
-                    case job_type::TameAnimal:
-                    case job_type::ChainAnimal:
-                    case job_type::UnchainAnimal:
-                    case job_type::UnchainPet:
-                    case job_type::ReleaseLargeCreature:
-                    case job_type::ReleasePet:
-                    case job_type::ReleaseSmallCreature:
-                    case job_type::HandleSmallCreature:
-                    case job_type::HandleLargeCreature:
-                    case job_type::CageLargeCreature:
-                    case job_type::CageSmallCreature:
-                    case job_type::PitLargeAnimal:
-                    case job_type::PitSmallAnimal:
-                    case job_type::SlaughterAnimal:
-                    case job_type::ShearCreature:
-                    case job_type::PenLargeAnimal:
-                    case job_type::PenSmallAnimal:
-                    case job_type::TrainAnimal:
-                        real_activity = JOB_ANIMALS;
-                        break;
-
-                    case job_type::PlantSeeds:
-                    case job_type::HarvestPlants:
-                    case job_type::FertilizeField:
-                        real_activity = JOB_AGRICULTURE;
-                        break;
-
-                    case job_type::ButcherAnimal:
-                    case job_type::PrepareRawFish:
-                    case job_type::MillPlants:
-                    case job_type::MilkCreature:
-                    case job_type::MakeCheese:
-                    case job_type::PrepareMeal:
-                    case job_type::ProcessPlants:
-                    case job_type::CollectHiveProducts:
-                        real_activity = JOB_FOOD_PROD;
-                        break;
-
-                    case job_type::LoadCatapult:
-                    case job_type::LoadBallista:
-                    case job_type::FireCatapult:
-                    case job_type::FireBallista:
-                        real_activity = JOB_MILITARY;
-                        break;
-
-                    case job_type::LoadCageTrap:
-                    case job_type::LoadStoneTrap:
-                    case job_type::LoadWeaponTrap:
-                    case job_type::CleanTrap:
-                    case job_type::LinkBuildingToTrigger:
-                    case job_type::PullLever:
-                        real_activity = JOB_MECHANICAL;
-                        break;
-
-                    case job_type::RecoverWounded:
-                    case job_type::DiagnosePatient:
-                    case job_type::ImmobilizeBreak:
-                    case job_type::DressWound:
-                    case job_type::CleanPatient:
-                    case job_type::Surgery:
-                    case job_type::Suture:
-                    case job_type::SetBone:
-                    case job_type::PlaceInTraction:
-                    case job_type::GiveWater:
-                    case job_type::GiveFood:
-                    case job_type::GiveWater2:
-                    case job_type::GiveFood2:
-                    case job_type::BringCrutch:
-                    case job_type::ApplyCast:
-                        real_activity = JOB_MEDICAL;
-                        break;
-
-                    case job_type::OperatePump:
-                    case job_type::ManageWorkOrders:
-                    case job_type::UpdateStockpileRecords:
-                    case job_type::TradeAtDepot:
-                        real_activity = JOB_PRODUCTIVE;
-                        break;
-
-                    default:
-                        break;
-                    }
+            auto activity = activity_history::get_activity(index);
+            auto category = get_activity_category(activity);
 
-                    addFortActivity(real_activity);
-                    addCategoryActivity(real_activity, *entry);
-                }
+            fort_activity_count += count;
+            addFortActivity(category, count);
+            if (activity >= 0)
+                addCategoryActivity(category, activity, count);
+        }
 
-                if (dwarf_activity_values.find(real_activity) == dwarf_activity_values.end())
-                    dwarf_activity_values[real_activity] = map<df::unit *, size_t>();
+        for (size_t slot = 0; slot < work_history.size(); slot++)
+        {
+            auto unit = work_history.get_unit(slot);
+            if (!unit)
+                continue;
 
-                map<df::unit *, size_t> &activity_for_dwarf = dwarf_activity_values[real_activity];
-                if (activity_for_dwarf.find(unit) == activity_for_dwarf.end())
-                    activity_for_dwarf[unit] = 0;
+            for (int index = 0; index < activity_history::num_activities(); index++)
+            {
+                size_t count = work_history.get_count(slot, window, index);
+                if (!count)
+                    continue;
 
-                ++activity_for_dwarf[unit];
+                auto category = get_activity_category(activity_history::get_activity(index));
+                dwarf_activity_values[category][unit] += count;
             }
         }
 
@@ -988,23 +1158,14 @@ public:
         return fort_activity_totals[activity];
     }
 
-    void addFortActivity(const activity_type activity)
+    void addFortActivity(const activity_type activity, const size_t count)
     {
-        if (fort_activity_totals.find(activity) == fort_activity_totals.end())
-            fort_activity_totals[activity] = 0;
-
-        fort_activity_totals[activity]++;
+        fort_activity_totals[activity] += count;
     }
 
-    void addCategoryActivity(const int category, const activity_type activity)
+    void addCategoryActivity(const int category, const activity_type activity, const size_t count)
     {
-        if (category_breakdown.find(category) == category_breakdown.end())
-            category_breakdown[category] = map<activity_type, size_t>();
-
-        if (category_breakdown[category].find(activity) == category_breakdown[category].end())
-            category_breakdown[category][activity] = 0;
-
-        category_breakdown[category][activity]++;
+        category_breakdown[category][activity] += count;
     }
 
     void feed(set<df::interface_key> *input)
@@ -1729,15 +1890,7 @@ static void open_stats_screen()
 
 static void add_work_history(df::unit *unit, activity_type type)
 {
-    if (work_history.find(unit) == work_history.end())
-    {
-        auto max_history = get_max_history();
-        for (int i = 0; i < max_history; i++)
-            work_history[unit].push_back(JOB_UNKNOWN);
-    }
-
-    work_history[unit].push_back(type);
-    work_history[unit].pop_front();
+    work_history.push(unit, type);
 }
 
 static bool is_at_leisure(df::unit *unit)
@@ -1777,10 +1930,7 @@ static void update_dwarf_stats(bool is_paused)
 
         if (!DFHack::Units::isActive(unit))
         {
-            auto it = work_history.find(unit);
-            if (it != work_history.end())
-                work_history.erase(it);
-
+            work_history.forget(unit);
             continue;
         }
 
@@ -0,0 +1,336 @@
+#include <fstream>
+#include <map>
+
+#include "Core.h"
+#include <Console.h>
+
+#include "modules/Filesystem.h"
+#include "modules/World.h"
+
+#include "DataDefs.h"
+#include "df/coord2d.h"
+#include "df/region_map_entry.h"
+#include "df/world.h"
+#include "df/world_data.h"
+#include "df/world_raws.h"
+
+#include "cache.h"
+#include "defs.h"
+#include "survey.h"
+
+using namespace DFHack;
+
+using df::global::world;
+
+namespace embark_assist {
+    namespace cache {
+        //  The file is a plain dump in native byte order, since it only ever serves the
+        //  installation that wrote it. Bump the version whenever the layout changes.
+        const uint32_t file_magic = 0x43534145;  //  "EASC"
+        const uint32_t file_version = 2;
+
+        //  The keys are computed when the cache is loaded, as the world may already be
+        //  gone by the time it's saved.
+        struct states {
+            uint32_t world_key;
+            std::vector<std::vector<uint32_t>> tile_keys;
+        };
+
+        static states *state = nullptr;
+
+        //  32 bit FNV-1a over the bytes of the values added.
+        class hasher {
+        public:
+            template <typename T>
+            void add(const T &value) {
+                const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+                for (size_t i = 0; i < sizeof(T); i++) {
+                    hash = (hash ^ bytes[i]) * 16777619u;
+                }
+            }
+
+            uint32_t value() const {
+                return hash;
+            }
+
+        private:
+            uint32_t hash = 2166136261u;
+        };
+
+        //=======================================================================================
+
+        struct writer {
+            std::ofstream &file;
+
+            template <typename T>
+            void operator()(const T &value) {
+                file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+            }
+        };
+
+        struct reader {
+            std::ifstream &file;
+
+            template <typename T>
+            void operator()(T &value) {
+                file.read(reinterpret_cast<char *>(&value), sizeof(T));
+            }
+        };
+
+        //=======================================================================================
+
+        //  The survey results that are kept in the cache, i.e. everything the high and mid
+        //  level surveys write. River sizes and evil weather are left out, as the passes that
+        //  set them run over all tiles after every survey anyway. The waterfall flag is only
+        //  found by the mid level survey, so it must be kept even though it's river data.
+        template <typename F, typename T>
+        void transfer_tile(F &f, T &tile) {
+            f(tile.surveyed);
+            f(tile.aquifer_count);
+            f(tile.clay_count);
+            f(tile.sand_count);
+            f(tile.flux_count);
+            f(tile.coal_count);
+            f(tile.min_region_soil);
+            f(tile.max_region_soil);
+            f(tile.waterfall);
+            f(tile.biome_index);
+            f(tile.biome);
+            f(tile.biome_count);
+            f(tile.min_temperature);
+            f(tile.max_temperature);
+            f(tile.savagery_count);
+            f(tile.evilness_count);
+        }
+
+        //=======================================================================================
+
+        //  Covers what the high level survey and the mid level survey depend on that is
+        //  already known when the assistant starts.
+        uint32_t world_key(embark_assist::defs::geo_data *geo_summary) {
+            hasher hash;
+
+            hash.add(world->worldgen.worldgen_parms.dim_x);
+            hash.add(world->worldgen.worldgen_parms.dim_y);
+            hash.add(world->raws.inorganics.size());
+            hash.add(geo_summary->size());
+
+            for (auto &geo : *geo_summary) {
+                hash.add(geo.soil_size);
+                hash.add(geo.top_soil_only);
+                hash.add(geo.top_soil_aquifer_only);
+                hash.add(geo.aquifer_absent);
+                hash.add(geo.clay_absent);
+                hash.add(geo.sand_absent);
+                hash.add(geo.flux_absent);
+                hash.add(geo.coal_absent);
+                for (auto word : geo.possible_metals.get_words()) hash.add(word);
+                for (auto word : geo.possible_economics.get_words()) hash.add(word);
+                for (auto word : geo.possible_minerals.get_words()) hash.add(word);
+            }
+
+            return hash.value();
+        }
+
+        //=======================================================================================
+
+        //  Covers the region map entries a world tile's survey reads, i.e. its own and
+        //  those of the neighbours its biomes may be taken from.
+        uint32_t tile_key(uint16_t x, uint16_t y) {
+            df::world_data *world_data = world->world_data;
+            hasher hash;
+
+            for (uint8_t l = 1; l < 10; l++) {
+                df::coord2d adjusted = embark_assist::survey::apply_offset(x, y, l);
+                auto &region = world_data->region_map[adjusted.x][adjusted.y];
+
+                hash.add(adjusted.x);
+                hash.add(adjusted.y);
+                hash.add(region.region_id);
+                hash.add(region.geo_index);
+                hash.add(region.elevation);
+                hash.add(region.rainfall);
+                hash.add(region.drainage);
+                hash.add(region.vegetation);
+                hash.add(region.temperature);
+                hash.add(region.salinity);
+                hash.add(region.savagery);
+                hash.add(region.evilness);
+                hash.add(region.flags.is_set(df::region_map_entry_flags::is_lake));
+            }
+
+            return hash.value();
+        }
+    }
+}
+
+//=================================================================================
+//  Exported operations
+//=================================================================================
+
+std::string embark_assist::cache::get_path() {
+    std::string folder = World::ReadWorldFolder();
+
+    if (folder.empty() || !Filesystem::isdir("data/save/" + folder)) {
+        return "";
+    }
+
+    return "data/save/" + folder + "/embark-assistant.dat";
+}
+
+//=================================================================================
+
+uint32_t embark_assist::cache::load(const std::string &path,
+    embark_assist::defs::geo_data *geo_summary,
+    embark_assist::defs::world_tile_data *survey_results,
+    cached_tiles *cached) {
+    uint16_t dim_x = world->worldgen.worldgen_parms.dim_x;
+    uint16_t dim_y = world->worldgen.worldgen_parms.dim_y;
+    uint32_t count = 0;
+
+    cached->assign(dim_x, std::vector<bool>(dim_y, false));
+
+    delete state;
+    state = new states;
+    state->world_key = world_key(geo_summary);
+    state->tile_keys.resize(dim_x);
+
+    for (uint16_t i = 0; i < dim_x; i++) {
+        state->tile_keys[i].resize(dim_y);
+        for (uint16_t k = 0; k < dim_y; k++) {
+            state->tile_keys[i][k] = tile_key(i, k);
+        }
+    }
+
+    if (path.empty() || !Filesystem::isfile(path)) {
+        return 0;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    reader read{ file };
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t key = 0;
+
+    read(magic);
+    read(version);
+    read(key);
+
+    if (!file || magic != file_magic || version != file_version || key != state->world_key) {
+        return 0;
+    }
+
+    uint32_t bits_count = 0;
+    read(bits_count);
+    std::vector<std::vector<uint64_t>> bits;
+
+    for (uint32_t i = 0; i < bits_count && file; i++) {
+        uint16_t word_count = 0;
+        read(word_count);
+        bits.emplace_back(word_count, 0);
+        file.read(reinterpret_cast<char *>(bits.back().data()), word_count * sizeof(uint64_t));
+    }
+
+    for (uint16_t i = 0; i < dim_x; i++) {
+        for (uint16_t k = 0; k < dim_y; k++) {
+            embark_assist::defs::region_tile_datum tile = survey_results->at(i).at(k);
+            uint32_t stored_key = 0;
+            uint32_t metals, economics, minerals;
+
+            read(stored_key);
+            transfer_tile(read, tile);
+            read(metals);
+            read(economics);
+            read(minerals);
+
+            if (!file) {
+                return count;
+            }
+
+            if (stored_key != state->tile_keys[i][k] ||
+                metals >= bits.size() ||
+                economics >= bits.size() ||
+                minerals >= bits.size()) {
+                continue;
+            }
+
+            tile.metals.set_words(bits[metals]);
+            tile.economics.set_words(bits[economics]);
+            tile.minerals.set_words(bits[minerals]);
+            survey_results->at(i).at(k) = tile;
+            cached->at(i).at(k) = true;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+//=================================================================================
+
+bool embark_assist::cache::save(const std::string &path,
+    embark_assist::defs::world_tile_data *survey_results) {
+    color_ostream_proxy out(Core::getInstance().getConsole());
+
+    if (path.empty() || !state) {
+        return false;
+    }
+
+    //  Most tiles share their mineral sets with many others, so each distinct set is
+    //  only stored once and the tiles refer to it by index.
+    std::map<std::vector<uint64_t>, uint32_t> bits_index;
+    std::vector<const std::vector<uint64_t> *> bits;
+    auto index_of = [&](const embark_assist::defs::inorganic_bits &set) {
+        auto it = bits_index.emplace(set.get_words(), bits.size());
+        if (it.second) bits.push_back(&it.first->first);
+        return it.first->second;
+    };
+
+    for (size_t i = 0; i < survey_results->size(); i++) {
+        for (size_t k = 0; k < survey_results->at(i).size(); k++) {
+            auto &tile = survey_results->at(i).at(k);
+            index_of(tile.metals);
+            index_of(tile.economics);
+            index_of(tile.minerals);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    writer write{ file };
+
+    write(file_magic);
+    write(file_version);
+    write(state->world_key);
+
+    write(uint32_t(bits.size()));
+    for (auto words : bits) {
+        write(uint16_t(words->size()));
+        file.write(reinterpret_cast<const char *>(words->data()), words->size() * sizeof(uint64_t));
+    }
+
+    for (size_t i = 0; i < survey_results->size(); i++) {
+        for (size_t k = 0; k < survey_results->at(i).size(); k++) {
+            auto &tile = survey_results->at(i).at(k);
+
+            write(state->tile_keys[i][k]);
+            transfer_tile(write, tile);
+            write(index_of(tile.metals));
+            write(index_of(tile.economics));
+            write(index_of(tile.minerals));
+        }
+    }
+
+    if (!file) {
+        out.printerr("Embark Assistant: failed to write the survey cache %s\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//=================================================================================
+
+void embark_assist::cache::shutdown() {
+    delete state;
+    state = nullptr;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "defs.h"
+
+namespace embark_assist {
+    namespace cache {
+        //  Per world tile flags telling which survey results were restored from the cache.
+        typedef std::vector<std::vector<bool>> cached_tiles;
+
+        //  Location of the survey cache in the world's save folder, or an empty string if
+        //  the world has no save folder yet.
+        std::string get_path();
+
+        //  Restores the survey results of all world tiles whose world data still matches
+        //  the data they were surveyed from, flagging them in cached. Returns the number of
+        //  tiles restored.
+        uint32_t load(const std::string &path,
+            embark_assist::defs::geo_data *geo_summary,
+            embark_assist::defs::world_tile_data *survey_results,
+            cached_tiles *cached);
+
+        //  Writes the survey results keyed on the world data seen by the last load.
+        bool save(const std::string &path,
+            embark_assist::defs::world_tile_data *survey_results);
+
+        void shutdown();
+    }
+}
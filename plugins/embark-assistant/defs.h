@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -23,6 +25,77 @@ namespace embark_assist {
             Major
         };
 
+        //  Set of inorganic material indices, stored as 64 bit words so whole sets can be
+        //  merged and compared a word at a time rather than one material at a time.
+        class inorganic_bits {
+        public:
+            void resize(size_t size) {
+                words.resize((size + 63) / 64, 0);
+            }
+
+            size_t size() const {
+                return words.size() * 64;
+            }
+
+            bool operator[](size_t index) const {
+                return index < size() && (words[index / 64] >> (index % 64)) & 1;
+            }
+
+            void set(size_t index) {
+                if (index >= size()) resize(index + 1);
+                words[index / 64] |= uint64_t(1) << (index % 64);
+            }
+
+            void clear() {
+                std::fill(words.begin(), words.end(), 0);
+            }
+
+            bool any() const {
+                for (auto word : words) {
+                    if (word) return true;
+                }
+                return false;
+            }
+
+            inorganic_bits &operator|=(const inorganic_bits &other) {
+                if (other.words.size() > words.size()) words.resize(other.words.size(), 0);
+                for (size_t i = 0; i < other.words.size(); i++) {
+                    words[i] |= other.words[i];
+                }
+                return *this;
+            }
+
+            //  Adds the materials of other that are also in mask.
+            void add_masked(const inorganic_bits &other, const inorganic_bits &mask) {
+                if (mask.words.size() > words.size()) words.resize(mask.words.size(), 0);
+                size_t end = std::min(other.words.size(), mask.words.size());
+                for (size_t i = 0; i < end; i++) {
+                    words[i] |= other.words[i] & mask.words[i];
+                }
+            }
+
+            //  True if every material in required is also in this set.
+            bool contains(const inorganic_bits &required) const {
+                for (size_t i = 0; i < required.words.size(); i++) {
+                    uint64_t word = i < words.size() ? words[i] : 0;
+                    if (required.words[i] & ~word) return false;
+                }
+                return true;
+            }
+
+            //  Raw word access for the survey cache.
+            const std::vector<uint64_t> &get_words() const {
+                return words;
+            }
+
+            void set_words(const std::vector<uint64_t> &new_words) {
+                words = new_words;
+            }
+
+        private:
+            std::vector<uint64_t> words;
+        };
+
         struct mid_level_tile {
             bool aquifer = false;
             bool clay = false;
@@ -39,9 +112,9 @@ namespace embark_assist {
             int8_t biome_offset;
             uint8_t savagery_level;  // 0 - 2
             uint8_t evilness_level;  // 0 - 2
-            std::vector<bool> metals;
-            std::vector<bool> economics;
-            std::vector<bool> minerals;
+            inorganic_bits metals;
+            inorganic_bits economics;
+            inorganic_bits minerals;
         };
 
         typedef std::array<std::array<mid_level_tile, 16>, 16> mid_level_tiles;
@@ -79,9 +152,9 @@ namespace embark_assist {
             bool thralling_full;
             uint16_t savagery_count[3];
             uint16_t evilness_count[3];
-            std::vector<bool> metals;
-            std::vector<bool> economics;
-            std::vector<bool> minerals;
+            inorganic_bits metals;
+            inorganic_bits economics;
+            inorganic_bits minerals;
         };
 
         struct geo_datum {
@@ -93,9 +166,9 @@ namespace embark_assist {
             bool sand_absent = true;
             bool flux_absent = true;
             bool coal_absent = true;
-            std::vector<bool> possible_metals;
-            std::vector<bool> possible_economics;
-            std::vector<bool> possible_minerals;
+            inorganic_bits possible_metals;
+            inorganic_bits possible_economics;
+            inorganic_bits possible_minerals;
         };
 
         typedef std::vector<geo_datum> geo_data;
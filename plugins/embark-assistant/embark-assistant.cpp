@@ -19,6 +19,7 @@
 #include "df/world_geo_biome.h"
 #include "df/world_raws.h"
 
+#include "cache.h"
 #include "defs.h"
 #include "embark-assistant.h"
 #include "finder_ui.h"
@@ -44,6 +45,8 @@ namespace embark_assist {
             embark_assist::defs::match_results match_results;
             embark_assist::defs::match_iterators match_iterator;
             uint16_t max_inorganic;
+            std::string cache_path;
+            uint32_t cached_surveyed;  //  Number of mid level surveyed world tiles in the cache file
         };
 
         static states *state = nullptr;
@@ -53,6 +56,20 @@ namespace embark_assist {
 
         //===============================================================================
 
+        uint32_t count_surveyed() {
+            uint32_t count = 0;
+
+            for (auto &column : state->survey_results) {
+                for (auto &tile : column) {
+                    if (tile.surveyed) count++;
+                }
+            }
+
+            return count;
+        }
+
+        //===============================================================================
+
         void embark_update() {
             auto screen = Gui::getViewscreenByType<df::viewscreen_choose_start_sitest>(0);
             embark_assist::defs::mid_level_tiles mlt;
@@ -116,6 +133,12 @@ namespace embark_assist {
 
         void shutdown() {
 //            color_ostream_proxy out(Core::getInstance().getConsole());
+            //  The matcher surveys world tiles in detail as it goes, so save them for the next session.
+            if (count_surveyed() != state->cached_surveyed) {
+                embark_assist::cache::save(state->cache_path, &state->survey_results);
+            }
+
+            embark_assist::cache::shutdown();
             embark_assist::survey::shutdown();
             embark_assist::finder_ui::shutdown();
             embark_assist::overlay::shutdown();
@@ -276,8 +299,24 @@ command_result embark_assistant(color_ostream &out, std::vector <std::string> &
         }
     }
 
+    embark_assist::survey::geo_survey(&embark_assist::main::state->geo_summary);
+
+    embark_assist::cache::cached_tiles cached;
+    embark_assist::main::state->cache_path = embark_assist::cache::get_path();
+    uint32_t restored = embark_assist::cache::load(embark_assist::main::state->cache_path,
+        &embark_assist::main::state->geo_summary,
+        &embark_assist::main::state->survey_results,
+        &cached);
+
     embark_assist::survey::high_level_world_survey(&embark_assist::main::state->geo_summary,
-        &embark_assist::main::state->survey_results);
+        &embark_assist::main::state->survey_results,
+        &cached);
+
+    if (restored < uint32_t(world->worldgen.worldgen_parms.dim_x * world->worldgen.worldgen_parms.dim_y)) {
+        embark_assist::cache::save(embark_assist::main::state->cache_path,
+            &embark_assist::main::state->survey_results);
+    }
+    embark_assist::main::state->cached_surveyed = embark_assist::main::count_surveyed();
 
     embark_assist::main::state->match_results.resize(world->worldgen.worldgen_parms.dim_x);
 
@@ -22,6 +22,36 @@ using df::global::world;
 namespace embark_assist {
     namespace matcher {
 
+        //  Metals, economics, and minerals required by the current search, set up once when
+        //  the search starts so tiles can be checked with a few word operations.
+        struct inorganic_requirements {
+            embark_assist::defs::inorganic_bits metals;
+            embark_assist::defs::inorganic_bits economics;
+            embark_assist::defs::inorganic_bits minerals;
+            bool any = false;
+        };
+
+        static inorganic_requirements required;
+        static inorganic_requirements found;  //  Scratch space for embark_match
+
+        //=======================================================================================
+
+        void set_requirements(embark_assist::defs::finders *finder) {
+            required = inorganic_requirements();
+
+            if (finder->metal_1 != -1) required.metals.set(finder->metal_1);
+            if (finder->metal_2 != -1) required.metals.set(finder->metal_2);
+            if (finder->metal_3 != -1) required.metals.set(finder->metal_3);
+            if (finder->economic_1 != -1) required.economics.set(finder->economic_1);
+            if (finder->economic_2 != -1) required.economics.set(finder->economic_2);
+            if (finder->economic_3 != -1) required.economics.set(finder->economic_3);
+            if (finder->mineral_1 != -1) required.minerals.set(finder->mineral_1);
+            if (finder->mineral_2 != -1) required.minerals.set(finder->mineral_2);
+            if (finder->mineral_3 != -1) required.minerals.set(finder->mineral_3);
+
+            required.any = required.metals.any() || required.economics.any() || required.minerals.any();
+        }
+
         //=======================================================================================
 
         //=======================================================================================
@@ -61,15 +91,10 @@ namespace embark_assist {
             bool biomes[ENUM_LAST_ITEM(biome_type) + 1];
             bool region_types[ENUM_LAST_ITEM(world_region_type) + 1];
             uint8_t biome_count;
-            bool metal_1 = finder->metal_1 == -1;
-            bool metal_2 = finder->metal_2 == -1;
-            bool metal_3 = finder->metal_3 == -1;
-            bool economic_1 = finder->economic_1 == -1;
-            bool economic_2 = finder->economic_2 == -1;
-            bool economic_3 = finder->economic_3 == -1;
-            bool mineral_1 = finder->mineral_1 == -1;
-            bool mineral_2 = finder->mineral_2 == -1;
-            bool mineral_3 = finder->mineral_3 == -1;
+
+            found.metals.clear();
+            found.economics.clear();
+            found.minerals.clear();
 
             const uint16_t embark_size = finder->x_dim * finder->y_dim;
 
@@ -269,20 +294,12 @@ namespace embark_assist {
                     //  Region Type
                     region_types[world_data->regions[survey_results->at(x).at(y).biome_index[mlt->at(i).at(k).biome_offset]]->type] = true;
                 
-                    //  Metals
-                    metal_1 = metal_1 || mlt->at(i).at(k).metals[finder->metal_1];
-                    metal_2 = metal_2 || mlt->at(i).at(k).metals[finder->metal_2];
-                    metal_3 = metal_3 || mlt->at(i).at(k).metals[finder->metal_3];
-
-                    //  Economics
-                    economic_1 = economic_1 || mlt->at(i).at(k).economics[finder->economic_1];
-                    economic_2 = economic_2 || mlt->at(i).at(k).economics[finder->economic_2];
-                    economic_3 = economic_3 || mlt->at(i).at(k).economics[finder->economic_3];
-
-                    //  Minerals
-                    mineral_1 = mineral_1 || mlt->at(i).at(k).minerals[finder->mineral_1];
-                    mineral_2 = mineral_2 || mlt->at(i).at(k).minerals[finder->mineral_2];
-                    mineral_3 = mineral_3 || mlt->at(i).at(k).minerals[finder->mineral_3];
+                    //  Metals, Economics, and Minerals
+                    if (required.any) {
+                        found.metals.add_masked(mlt->at(i).at(k).metals, required.metals);
+                        found.economics.add_masked(mlt->at(i).at(k).economics, required.economics);
+                        found.minerals.add_masked(mlt->at(i).at(k).minerals, required.minerals);
+                    }
                 }
             }
 
@@ -406,15 +423,9 @@ namespace embark_assist {
             if (finder->region_type_3 != -1 && !region_types[finder->region_type_3]) return false;
 
             //  Metals, Economics, and Minerals
-            if (!metal_1 ||
-                !metal_2 ||
-                !metal_3 ||
-                !economic_1 ||
-                !economic_2 ||
-                !economic_3 ||
-                !mineral_1 ||
-                !mineral_2 ||
-                !mineral_3) return false;
+            if (!found.metals.contains(required.metals) ||
+                !found.economics.contains(required.economics) ||
+                !found.minerals.contains(required.minerals)) return false;
 
             return true;
         }
@@ -903,44 +914,10 @@ namespace embark_assist {
                     if (!found) return false;
                 }
 
-                if (finder->metal_1 != -1 ||
-                    finder->metal_2 != -1 ||
-                    finder->metal_3 != -1 ||
-                    finder->economic_1 != -1 ||
-                    finder->economic_2 != -1 ||
-                    finder->economic_3 != -1 ||
-                    finder->mineral_1 != -1 ||
-                    finder->mineral_2 != -1 ||
-                    finder->mineral_3 != -1) {
-                    bool metal_1 = finder->metal_1 == -1;
-                    bool metal_2 = finder->metal_2 == -1;
-                    bool metal_3 = finder->metal_3 == -1;
-                    bool economic_1 = finder->economic_1 == -1;
-                    bool economic_2 = finder->economic_2 == -1;
-                    bool economic_3 = finder->economic_3 == -1;
-                    bool mineral_1 = finder->mineral_1 == -1;
-                    bool mineral_2 = finder->mineral_2 == -1;
-                    bool mineral_3 = finder->mineral_3 == -1;
-
-                    metal_1 = metal_1 || tile->metals[finder->metal_1];
-                    metal_2 = metal_2 || tile->metals[finder->metal_2];
-                    metal_3 = metal_3 || tile->metals[finder->metal_3];
-                    economic_1 = economic_1 || tile->economics[finder->economic_1];
-                    economic_2 = economic_2 || tile->economics[finder->economic_2];
-                    economic_3 = economic_3 || tile->economics[finder->economic_3];
-                    mineral_1 = mineral_1 || tile->minerals[finder->mineral_1];
-                    mineral_2 = mineral_2 || tile->minerals[finder->mineral_2];
-                    mineral_3 = mineral_3 || tile->minerals[finder->mineral_3];
-
-                    if (!metal_1 ||
-                        !metal_2 ||
-                        !metal_3 ||
-                        !economic_1 ||
-                        !economic_2 ||
-                        !economic_3 ||
-                        !mineral_1 ||
-                        !mineral_2 ||
-                        !mineral_3) return false;
+                if (required.any) {
+                    if (!tile->metals.contains(required.metals) ||
+                        !tile->economics.contains(required.economics) ||
+                        !tile->minerals.contains(required.minerals)) return false;
                 }
             }
             else {  //  Not surveyed
@@ -1301,44 +1278,10 @@ namespace embark_assist {
                     if (!found) return false;
                 }
 
-                if (finder->metal_1 != -1 ||
-                    finder->metal_2 != -1 ||
-                    finder->metal_3 != -1 ||
-                    finder->economic_1 != -1 ||
-                    finder->economic_2 != -1 ||
-                    finder->economic_3 != -1 ||
-                    finder->mineral_1 != -1 ||
-                    finder->mineral_2 != -1 ||
-                    finder->mineral_3 != -1) {
-                    bool metal_1 = finder->metal_1 == -1;
-                    bool metal_2 = finder->metal_2 == -1;
-                    bool metal_3 = finder->metal_3 == -1;
-                    bool economic_1 = finder->economic_1 == -1;
-                    bool economic_2 = finder->economic_2 == -1;
-                    bool economic_3 = finder->economic_3 == -1;
-                    bool mineral_1 = finder->mineral_1 == -1;
-                    bool mineral_2 = finder->mineral_2 == -1;
-                    bool mineral_3 = finder->mineral_3 == -1;
-
-                    metal_1 = metal_1 || tile->metals[finder->metal_1];
-                    metal_2 = metal_2 || tile->metals[finder->metal_2];
-                    metal_3 = metal_3 || tile->metals[finder->metal_3];
-                    economic_1 = economic_1 || tile->economics[finder->economic_1];
-                    economic_2 = economic_2 || tile->economics[finder->economic_2];
-                    economic_3 = economic_3 || tile->economics[finder->economic_3];
-                    mineral_1 = mineral_1 || tile->minerals[finder->mineral_1];
-                    mineral_2 = mineral_2 || tile->minerals[finder->mineral_2];
-                    mineral_3 = mineral_3 || tile->minerals[finder->mineral_3];
-
-                    if (!metal_1 ||
-                        !metal_2 ||
-                        !metal_3 ||
-                        !economic_1 ||
-                        !economic_2 ||
-                        !economic_3 ||
-                        !mineral_1 ||
-                        !mineral_2 ||
-                        !mineral_3) return false;
+                if (required.any) {
+                    if (!tile->metals.contains(required.metals) ||
+                        !tile->economics.contains(required.economics) ||
+                        !tile->minerals.contains(required.minerals)) return false;
                 }
             }
             return true;
@@ -1559,6 +1502,7 @@ uint16_t embark_assist::matcher::find(embark_assist::defs::match_iterators *iter
             return 0;
         }
 
+        set_requirements(&iterator->finder);
         preliminary_matches = preliminary_world_match(survey_results, &iterator->finder, match_results);
 
         if (preliminary_matches == 0) {
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <math.h>
+#include <thread>
 #include <vector>
 
 #include "Core.h"
@@ -149,17 +153,17 @@ namespace embark_assist {
                         non_soil_found = true;
                     }
 
-                    geo_summary->at(i).possible_minerals[layer->mat_index] = true;
+                    geo_summary->at(i).possible_minerals.set(layer->mat_index);
 
                     size = (uint16_t)world->raws.inorganics[layer->mat_index]->metal_ore.mat_index.size();
 
                     for (uint16_t l = 0; l < size; l++) {
-                        geo_summary->at(i).possible_metals.at(world->raws.inorganics[layer->mat_index]->metal_ore.mat_index[l]) = true;
+                        geo_summary->at(i).possible_metals.set(world->raws.inorganics[layer->mat_index]->metal_ore.mat_index[l]);
                     }
 
                     size = (uint16_t)world->raws.inorganics[layer->mat_index]->economic_uses.size();
                     if (size != 0) {
-                        geo_summary->at(i).possible_economics[layer->mat_index] = true;
+                        geo_summary->at(i).possible_economics.set(layer->mat_index);
 
                         for (uint16_t l = 0; l < size; l++) {
                             if (world->raws.inorganics[layer->mat_index]->economic_uses[l] == state->clay_reaction) {
@@ -183,14 +187,14 @@ namespace embark_assist {
 
                     for (uint16_t l = 0; l < size; l++) {
                         auto vein = layer->vein_mat[l];
-                        geo_summary->at(i).possible_minerals[vein] = true;
+                        geo_summary->at(i).possible_minerals.set(vein);
 
                         for (uint16_t m = 0; m < world->raws.inorganics[vein]->metal_ore.mat_index.size(); m++) {
-                            geo_summary->at(i).possible_metals.at(world->raws.inorganics[vein]->metal_ore.mat_index[m]) = true;
+                            geo_summary->at(i).possible_metals.set(world->raws.inorganics[vein]->metal_ore.mat_index[m]);
                         }
 
                         if (world->raws.inorganics[vein]->economic_uses.size() != 0) {
-                            geo_summary->at(i).possible_economics[vein] = true;
+                            geo_summary->at(i).possible_economics.set(vein);
 
                             for (uint16_t m = 0; m < world->raws.inorganics[vein]->economic_uses.size(); m++) {
                                 if (world->raws.inorganics[vein]->economic_uses[m] == state->clay_reaction) {
@@ -494,65 +498,15 @@ namespace embark_assist {
 
             return max_temperature - ceil(divisor * 3 / 4);
         }
-    }
-}
-
-//=================================================================================
-//  Exported operations
-//=================================================================================
-
-void embark_assist::survey::setup(uint16_t max_inorganic) {
-    embark_assist::survey::state = new(embark_assist::survey::states);
-    embark_assist::survey::state->max_inorganic = max_inorganic;
-}
-
-//=================================================================================
-
-df::coord2d embark_assist::survey::get_last_pos() {
-    return{ embark_assist::survey::state->x, embark_assist::survey::state->y };
-}
-
-//=================================================================================
-
-void embark_assist::survey::initiate(embark_assist::defs::mid_level_tiles *mlt) {
-    for (uint8_t i = 0; i < 16; i++) {
-        for (uint8_t k = 0; k < 16; k++) {
-            mlt->at(i).at(k).metals.resize(state->max_inorganic);
-            mlt->at(i).at(k).economics.resize(state->max_inorganic);
-            mlt->at(i).at(k).minerals.resize(state->max_inorganic);
-        }
-    }
-}
 
-//=================================================================================
-
-void embark_assist::survey::clear_results(embark_assist::defs::match_results *match_results) {
-    for (uint16_t i = 0; i < world->worldgen.worldgen_parms.dim_x; i++) {
-        for (uint16_t k = 0; k < world->worldgen.worldgen_parms.dim_y; k++) {
-            match_results->at(i).at(k).preliminary_match = false;
-            match_results->at(i).at(k).contains_match = false;
-
-            for (uint16_t l = 0; l < 16; l++) {
-                for (uint16_t m = 0; m < 16; m++) {
-                    match_results->at(i).at(k).mlt_match[l][m] = false;
-                }
-            }
-        }
-    }
-}
-
-//=================================================================================
-
-void embark_assist::survey::high_level_world_survey(embark_assist::defs::geo_data *geo_summary,
-    embark_assist::defs::world_tile_data *survey_results) {
-//    color_ostream_proxy out(Core::getInstance().getConsole());
-
-    int16_t temperature;
-    bool negative;
+        //=================================================================================
 
-    embark_assist::survey::geo_survey(geo_summary);
-    for (uint16_t i = 0; i < world->worldgen.worldgen_parms.dim_x; i++) {
-        for (uint16_t k = 0; k < world->worldgen.worldgen_parms.dim_y; k++) {
+        void survey_world_tile(embark_assist::defs::geo_data *geo_summary,
+            embark_assist::defs::world_tile_data *survey_results,
+            uint16_t i,
+            uint16_t k) {
+            int16_t temperature;
+            bool negative;
             df::coord2d adjusted;
             df::world_data *world_data = world->world_data;
             uint16_t geo_index;
@@ -626,11 +580,9 @@ void embark_assist::survey::high_level_world_survey(embark_assist::defs::geo_dat
                     if (sav_ev == 3) sav_ev = 2;
                     results.evilness_count[sav_ev]++;
 
-                    for (uint16_t m = 0; m < state->max_inorganic; m++) {
-                        if (geo_summary->at(geo_index).possible_metals[m]) results.metals[m] = true;
-                        if (geo_summary->at(geo_index).possible_economics[m]) results.economics[m] = true;
-                        if (geo_summary->at(geo_index).possible_minerals[m]) results.minerals[m] = true;
-                    }
+                    results.metals |= geo_summary->at(geo_index).possible_metals;
+                    results.economics |= geo_summary->at(geo_index).possible_economics;
+                    results.minerals |= geo_summary->at(geo_index).possible_minerals;
                 }
                 else {
                     results.biome_index[l] = -1;
@@ -657,9 +609,94 @@ void embark_assist::survey::high_level_world_survey(embark_assist::defs::geo_dat
             }
         }
     }
+}
+
+//=================================================================================
+//  Exported operations
+//=================================================================================
+
+void embark_assist::survey::setup(uint16_t max_inorganic) {
+    embark_assist::survey::state = new(embark_assist::survey::states);
+    embark_assist::survey::state->max_inorganic = max_inorganic;
+}
+
+//=================================================================================
+
+df::coord2d embark_assist::survey::get_last_pos() {
+    return{ embark_assist::survey::state->x, embark_assist::survey::state->y };
+}
+
+//=================================================================================
+
+void embark_assist::survey::initiate(embark_assist::defs::mid_level_tiles *mlt) {
+    for (uint8_t i = 0; i < 16; i++) {
+        for (uint8_t k = 0; k < 16; k++) {
+            mlt->at(i).at(k).metals.resize(state->max_inorganic);
+            mlt->at(i).at(k).economics.resize(state->max_inorganic);
+            mlt->at(i).at(k).minerals.resize(state->max_inorganic);
+        }
+    }
+}
+
+//=================================================================================
+
+void embark_assist::survey::clear_results(embark_assist::defs::match_results *match_results) {
+    for (uint16_t i = 0; i < world->worldgen.worldgen_parms.dim_x; i++) {
+        for (uint16_t k = 0; k < world->worldgen.worldgen_parms.dim_y; k++) {
+            match_results->at(i).at(k).preliminary_match = false;
+            match_results->at(i).at(k).contains_match = false;
+
+            for (uint16_t l = 0; l < 16; l++) {
+                for (uint16_t m = 0; m < 16; m++) {
+                    match_results->at(i).at(k).mlt_match[l][m] = false;
+                }
+            }
+        }
+    }
+}
+
+//=================================================================================
+
+void embark_assist::survey::high_level_world_survey(embark_assist::defs::geo_data *geo_summary,
+    embark_assist::defs::world_tile_data *survey_results,
+    embark_assist::cache::cached_tiles *cached) {
+    color_ostream_proxy out(Core::getInstance().getConsole());
+
+    auto start = std::chrono::steady_clock::now();
+    uint16_t dim_x = world->worldgen.worldgen_parms.dim_x;
+    uint16_t dim_y = world->worldgen.worldgen_parms.dim_y;
+    std::atomic<int> surveyed(0);
+
+    //  Each world tile only reads the world data and writes its own results, so the
+    //  columns are handed out to a set of worker threads.
+    std::atomic<size_t> next_column(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next_column++) < dim_x; ) {
+            for (uint16_t k = 0; k < dim_y; k++) {
+                if (cached->at(i).at(k)) continue;
+                survey_world_tile(geo_summary, survey_results, i, k);
+                surveyed++;
+            }
+        }
+    };
+
+    size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
 
     embark_assist::survey::survey_rivers(survey_results);
     embark_assist::survey::survey_evil_weather(survey_results);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    out.print("Embark Assistant: surveyed %d world tiles in %.2f s (%.0f tiles/s, %d threads), %d restored from cache\n",
+        (int)surveyed, elapsed.count(), elapsed.count() > 0 ? surveyed / elapsed.count() : 0.0, (int)thread_count,
+        dim_x * dim_y - (int)surveyed);
 }
 
 //=================================================================================
@@ -690,11 +727,9 @@ void embark_assist::survey::survey_mid_level_tile(embark_assist::defs::geo_data
     uint16_t end_check_m;
     uint16_t end_check_n;
 
-    for (uint16_t i = 0; i < state->max_inorganic; i++) {
-        tile->metals[i] = 0;
-        tile->economics[i] = 0;
-        tile->minerals[i] = 0;
-    }
+    tile->metals.clear();
+    tile->economics.clear();
+    tile->minerals.clear();
 
     for (uint8_t i = 0; i < 16; i++) {
         for (uint8_t k = 0; k < 16; k++) {
@@ -880,12 +915,12 @@ void embark_assist::survey::survey_mid_level_tile(embark_assist::defs::geo_data
                 }
 
                 if (top_z >= bottom_z) {
-                    mlt->at(i).at(k).minerals[layer->mat_index] = true;
+                    mlt->at(i).at(k).minerals.set(layer->mat_index);
 
                     end_check_m = static_cast<uint16_t>(world->raws.inorganics[layer->mat_index]->metal_ore.mat_index.size());
 
                     for (uint16_t m = 0; m < end_check_m; m++) {
-                        mlt->at(i).at(k).metals[world->raws.inorganics[layer->mat_index]->metal_ore.mat_index[m]] = true;
+                        mlt->at(i).at(k).metals.set(world->raws.inorganics[layer->mat_index]->metal_ore.mat_index[m]);
                     }
 
                     if (layer->type == df::geo_layer_type::SOIL ||
@@ -896,7 +931,7 @@ void embark_assist::survey::survey_mid_level_tile(embark_assist::defs::geo_data
                     }
 
                     if (world->raws.inorganics[layer->mat_index]->economic_uses.size() > 0) {
-                        mlt->at(i).at(k).economics[layer->mat_index] = true;
+                        mlt->at(i).at(k).economics.set(layer->mat_index);
 
                         end_check_m = static_cast<uint16_t>(world->raws.inorganics[layer->mat_index]->economic_uses.size());
                         for (uint16_t m = 0; m < end_check_m; m++) {
@@ -920,16 +955,16 @@ void embark_assist::survey::survey_mid_level_tile(embark_assist::defs::geo_data
                     end_check_m = static_cast<uint16_t>(layer->vein_mat.size());
 
                     for (uint16_t m = 0; m < end_check_m; m++) {
-                        mlt->at(i).at(k).minerals[layer->vein_mat[m]] = true;
+                        mlt->at(i).at(k).minerals.set(layer->vein_mat[m]);
 
                         end_check_n = static_cast<uint16_t>(world->raws.inorganics[layer->vein_mat[m]]->metal_ore.mat_index.size());
 
                         for (uint16_t n = 0; n < end_check_n; n++) {
-                            mlt->at(i).at(k).metals[world->raws.inorganics[layer->vein_mat[m]]->metal_ore.mat_index[n]] = true;
+                            mlt->at(i).at(k).metals.set(world->raws.inorganics[layer->vein_mat[m]]->metal_ore.mat_index[n]);
                         }
 
                         if (world->raws.inorganics[layer->vein_mat[m]]->economic_uses.size() > 0) {
-                            mlt->at(i).at(k).economics[layer->vein_mat[m]] = true;
+                            mlt->at(i).at(k).economics.set(layer->vein_mat[m]);
 
                             end_check_n = static_cast<uint16_t>(world->raws.inorganics[layer->vein_mat[m]]->economic_uses.size());
                             for (uint16_t n = 0; n < end_check_n; n++) {
@@ -1016,11 +1051,9 @@ void embark_assist::survey::survey_mid_level_tile(embark_assist::defs::geo_data
             survey_results->at(x).at(y).savagery_count[mlt->at(i).at(k).savagery_level]++;
             survey_results->at(x).at(y).evilness_count[mlt->at(i).at(k).evilness_level]++;
 
-            for (uint16_t l = 0; l < state->max_inorganic; l++) {
-                if (mlt->at(i).at(k).metals[l]) { survey_results->at(x).at(y).metals[l] = true; }
-                if (mlt->at(i).at(k).economics[l]) { survey_results->at(x).at(y).economics[l] = true; }
-                if (mlt->at(i).at(k).minerals[l]) { survey_results->at(x).at(y).minerals[l] = true; }
-            }
+            survey_results->at(x).at(y).metals |= mlt->at(i).at(k).metals;
+            survey_results->at(x).at(y).economics |= mlt->at(i).at(k).economics;
+            survey_results->at(x).at(y).minerals |= mlt->at(i).at(k).minerals;
         }
     }
 
@@ -1202,9 +1235,9 @@ void embark_assist::survey::survey_embark(embark_assist::defs::mid_level_tiles *
     uint16_t y = screen->location.region_pos.y;
     bool river_found = false;
     int16_t river_elevation = 0;
-    std::vector<bool> metals(state->max_inorganic);
-    std::vector<bool> economics(state->max_inorganic);
-    std::vector<bool> minerals(state->max_inorganic);
+    embark_assist::defs::inorganic_bits metals;
+    embark_assist::defs::inorganic_bits economics;
+    embark_assist::defs::inorganic_bits minerals;
 
     if (!use_cache) {  //  For some reason DF scrambles these values on world tile movements (at least in Lua...).
         state->local_min_x = screen->location.embark_pos_min.x;
@@ -1282,11 +1315,9 @@ void embark_assist::survey::survey_embark(embark_assist::defs::mid_level_tiles *
                 site_info->coal = true;
             }
 
-            for (uint16_t l = 0; l < state->max_inorganic; l++) {
-                metals[l] = metals[l] || mlt->at(i).at(k).metals[l];
-                economics[l] = economics[l] || mlt->at(i).at(k).economics[l];
-                minerals[l] = minerals[l] || mlt->at(i).at(k).minerals[l];
-            }
+            metals |= mlt->at(i).at(k).metals;
+            economics |= mlt->at(i).at(k).economics;
+            minerals |= mlt->at(i).at(k).minerals;
         }
     }
     for (uint16_t l = 0; l < state->max_inorganic; l++) {
@@ -4,6 +4,7 @@
 #include "DataDefs.h"
 #include "df/coord2d.h"
 
+#include "cache.h"
 #include "defs.h"
 
 using namespace DFHack;
@@ -18,8 +19,12 @@ namespace embark_assist {
 
         void clear_results(embark_assist::defs::match_results *match_results);
 
+        bool geo_survey(embark_assist::defs::geo_data *geo_summary);
+
+        //  Surveys all world tiles that weren't restored from the cache.
         void high_level_world_survey(embark_assist::defs::geo_data *geo_summary,
-            embark_assist::defs::world_tile_data *survey_results);
+            embark_assist::defs::world_tile_data *survey_results,
+            embark_assist::cache::cached_tiles *cached);
 
         void survey_mid_level_tile(embark_assist::defs::geo_data *geo_summary,
             embark_assist::defs::world_tile_data *survey_results,
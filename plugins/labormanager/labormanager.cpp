@@ -14,12 +14,15 @@
 #include <queue>
 #include <map>
 #include <iterator>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "modules/Units.h"
 #include "modules/World.h"
 #include "modules/Maps.h"
 #include "modules/MapCache.h"
 #include "modules/Items.h"
+#include "modules/EventManager.h"
 
 // DF data structure definition headers
 #include "DataDefs.h"
@@ -574,6 +577,75 @@ static JobLaborMapper* labor_mapper = 0;
 
 static bool initialized = false;
 
+/*
+ * State kept between labor cycles, so that each cycle only looks at what
+ * may have changed:
+ * - buildings are rescanned after an EventManager BUILDING event;
+ * - designations are counted per map block, and a block is recounted when
+ *   its designated flag changes, when DF reprocesses designations, or when
+ *   the round-robin cursor reaches it;
+ * - counts derived from the item list are refreshed every few cycles.
+ */
+static const size_t DESIGNATION_RESCAN_BLOCKS = 256;
+static const int ITEM_SCAN_INTERVAL = 20;
+
+struct designation_count
+{
+    int dig, tree, plant, detail;
+
+    void add(const designation_count &other, int sign)
+    {
+        dig += sign * other.dig;
+        tree += sign * other.tree;
+        plant += sign * other.plant;
+        detail += sign * other.detail;
+    }
+};
+
+struct labor_cache_t
+{
+    bool buildings_dirty;
+    bool has_butchers;
+    bool has_fishery;
+    std::vector<int32_t> depots;
+
+    bool rescan_designations;
+    bool own_process_dig;
+    size_t designation_cursor;
+    std::unordered_map<df::map_block*, designation_count> block_designations;
+    designation_count designations;
+
+    int item_scan_countdown;
+    int tool_count[TOOLS_MAX];
+    int refuse_count;
+    int priority_food;
+
+    void reset()
+    {
+        buildings_dirty = true;
+        has_butchers = has_fishery = false;
+        depots.clear();
+        rescan_designations = true;
+        own_process_dig = false;
+        designation_cursor = 0;
+        block_designations.clear();
+        designations = designation_count();
+        item_scan_countdown = 0;
+        for (int e = 0; e < TOOLS_MAX; e++)
+            tool_count[e] = 0;
+        refuse_count = priority_food = 0;
+    }
+};
+
+static labor_cache_t labor_cache;
+
+static void on_building_event(color_ostream &out, void *ptr)
+{
+    labor_cache.buildings_dirty = true;
+}
+
+static EventManager::EventHandler building_handler(on_building_event, 50);
+
 static bool isOptionEnabled(unsigned flag)
 {
     return config.isValid() && (config.ival(0) & flag) != 0;
@@ -594,6 +666,8 @@ static void cleanup_state()
 {
     enable_labormanager = false;
     labor_infos.clear();
+    labor_cache.reset();
+    EventManager::unregisterAll(plugin_self);
     initialized = false;
 }
 
@@ -645,6 +719,9 @@ static void init_state()
         reset_labor((df::unit_labor) i);
     }
 
+    labor_cache.reset();
+    EventManager::registerListener(EventManager::EventType::BUILDING, building_handler, plugin_self);
+
     initialized = true;
 
 }
@@ -896,10 +973,15 @@ DFhackCExport command_result plugin_shutdown(color_ostream &out)
 class AutoLaborManager {
     color_ostream& out;
 
+    enum { NUM_LABORS = ENUM_LAST_ITEM(unit_labor) + 1 };
+
 public:
     AutoLaborManager(color_ostream& o) : out(o)
     {
         dwarf_info.clear();
+        std::fill(labor_needed, labor_needed + NUM_LABORS, 0);
+        std::fill(labor_in_use, labor_in_use + NUM_LABORS, 0);
+        std::fill(labor_outside, labor_outside + NUM_LABORS, false);
     }
 
     ~AutoLaborManager()
@@ -948,9 +1030,10 @@ private:
 
     int priority_food;
 
-    std::map<df::unit_labor, int> labor_needed;
-    std::map<df::unit_labor, int> labor_in_use;
-    std::map<df::unit_labor, bool> labor_outside;
+    // indexed by unit_labor
+    int labor_needed[NUM_LABORS];
+    int labor_in_use[NUM_LABORS];
+    bool labor_outside[NUM_LABORS];
     std::vector<dwarf_info_t*> dwarf_info;
     std::list<dwarf_info_t*> available_dwarfs;
     std::list<dwarf_info_t*> busy_dwarfs;
@@ -1044,26 +1127,42 @@ private:
 
     void scan_buildings()
     {
-        has_butchers = false;
-        has_fishery = false;
         trader_requested = false;
         labors_changed = false;
 
-        for (auto b = world->buildings.all.begin(); b != world->buildings.all.end(); b++)
+        if (labor_cache.buildings_dirty)
         {
-            df::building *build = *b;
-            auto type = build->getType();
-            if (building_type::Workshop == type)
+            labor_cache.buildings_dirty = false;
+            labor_cache.has_butchers = false;
+            labor_cache.has_fishery = false;
+            labor_cache.depots.clear();
+
+            for (auto b = world->buildings.all.begin(); b != world->buildings.all.end(); b++)
             {
-                df::workshop_type subType = (df::workshop_type)build->getSubtype();
-                if (workshop_type::Butchers == subType)
-                    has_butchers = true;
-                if (workshop_type::Fishery == subType)
-                    has_fishery = true;
+                df::building *build = *b;
+                auto type = build->getType();
+                if (building_type::Workshop == type)
+                {
+                    df::workshop_type subType = (df::workshop_type)build->getSubtype();
+                    if (workshop_type::Butchers == subType)
+                        labor_cache.has_butchers = true;
+                    if (workshop_type::Fishery == subType)
+                        labor_cache.has_fishery = true;
+                }
+                else if (building_type::TradeDepot == type)
+                    labor_cache.depots.push_back(build->id);
             }
-            else if (building_type::TradeDepot == type)
+        }
+
+        has_butchers = labor_cache.has_butchers;
+        has_fishery = labor_cache.has_fishery;
+
+        // the trader flag is toggled from the depot screen without a building event
+        for (auto id : labor_cache.depots)
+        {
+            auto depot = virtual_cast<df::building_tradedepotst>(df::building::find(id));
+            if (depot)
             {
-                df::building_tradedepotst* depot = (df::building_tradedepotst*) build;
                 trader_requested = depot->trade_flags.bits.trader_requested;
 
                 if (print_debug)
@@ -1078,48 +1177,94 @@ private:
         }
     }
 
-    void count_map_designations()
+    static designation_count count_block_designations(df::map_block* bl)
     {
-        dig_count = 0;
-        tree_count = 0;
-        plant_count = 0;
-        detail_count = 0;
+        designation_count count = designation_count();
 
-        for (size_t i = 0; i < world->map.map_blocks.size(); ++i)
+        for (int x = 0; x < 16; x++)
+            for (int y = 0; y < 16; y++)
+            {
+                if (bl->designation[x][y].bits.hidden)
+                {
+                    df::coord p = bl->map_pos;
+                    if (! Maps::isTileVisible(p.x, p.y, p.z-1))
+                        continue;
+                }
+
+                df::tile_dig_designation dig = bl->designation[x][y].bits.dig;
+                if (dig != df::enums::tile_dig_designation::No)
+                {
+                    df::tiletype tt = bl->tiletype[x][y];
+                    df::tiletype_material ttm = ENUM_ATTR(tiletype, material, tt);
+                    df::tiletype_shape tts = ENUM_ATTR(tiletype, shape, tt);
+                    if (ttm == df::enums::tiletype_material::TREE)
+                        count.tree++;
+                    else if (tts == df::enums::tiletype_shape::SHRUB)
+                        count.plant++;
+                    else
+                        count.dig++;
+                }
+                if (bl->designation[x][y].bits.smooth != 0)
+                    count.detail++;
+            }
+
+        return count;
+    }
+
+    void count_map_designations()
+    {
+        auto &blocks = world->map.map_blocks;
+        auto &counts = labor_cache.block_designations;
+        auto &total = labor_cache.designations;
+
+        // only the designated flag is checked for most blocks; the tiles are
+        // recounted for newly flagged blocks and a round-robin window
+        size_t cursor = labor_cache.designation_cursor;
+        if (cursor >= blocks.size())
+            cursor = 0;
+        size_t window_end = cursor + DESIGNATION_RESCAN_BLOCKS;
+
+        // drop blocks that are no longer designated
+        for (auto it = counts.begin(); it != counts.end(); )
         {
-            df::map_block* bl = world->map.map_blocks[i];
+            if (it->first->flags.bits.designated)
+            {
+                ++it;
+                continue;
+            }
+            total.add(it->second, -1);
+            it = counts.erase(it);
+        }
 
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            df::map_block* bl = blocks[i];
             if (!bl->flags.bits.designated)
                 continue;
 
-            for (int x = 0; x < 16; x++)
-                for (int y = 0; y < 16; y++)
-                {
-                    if (bl->designation[x][y].bits.hidden)
-                    {
-                        df::coord p = bl->map_pos;
-                        if (! Maps::isTileVisible(p.x, p.y, p.z-1))
-                            continue;
-                    }
+            auto it = counts.find(bl);
+            bool in_window = (i >= cursor && i < window_end) ||
+                (window_end > blocks.size() && i < window_end - blocks.size());
 
-                    df::tile_dig_designation dig = bl->designation[x][y].bits.dig;
-                    if (dig != df::enums::tile_dig_designation::No)
-                    {
-                        df::tiletype tt = bl->tiletype[x][y];
-                        df::tiletype_material ttm = ENUM_ATTR(tiletype, material, tt);
-                        df::tiletype_shape tts = ENUM_ATTR(tiletype, shape, tt);
-                        if (ttm == df::enums::tiletype_material::TREE)
-                            tree_count++;
-                        else if (tts == df::enums::tiletype_shape::SHRUB)
-                            plant_count++;
-                        else
-                            dig_count++;
-                    }
-                    if (bl->designation[x][y].bits.smooth != 0)
-                        detail_count++;
-                }
+            if (it == counts.end())
+                it = counts.insert(std::make_pair(bl, designation_count())).first;
+            else if (!labor_cache.rescan_designations && !in_window)
+                continue;
+
+            designation_count count = count_block_designations(bl);
+            total.add(it->second, -1);
+            total.add(count, 1);
+            it->second = count;
         }
 
+        labor_cache.designation_cursor = blocks.empty() ? 0 : window_end % blocks.size();
+        labor_cache.rescan_designations = false;
+
+        dig_count = total.dig;
+        tree_count = total.tree;
+        plant_count = total.plant;
+        detail_count = total.detail;
+
         if (print_debug)
             out.print("Dig count = %d, Cut tree count = %d, gather plant count = %d, detail count = %d\n", dig_count, tree_count, plant_count, detail_count);
 
@@ -1133,7 +1278,19 @@ private:
             tool_in_use[e] = 0;
         }
 
+        if (labor_cache.item_scan_countdown-- > 0)
+        {
+            for (int e = TOOL_NONE; e < TOOLS_MAX; e++)
+                tool_count[e] = labor_cache.tool_count[e];
+            priority_food = labor_cache.priority_food;
+            if (!labor_infos[df::unit_labor::HAUL_REFUSE].is_unmanaged())
+                labor_needed[df::unit_labor::HAUL_REFUSE] += labor_cache.refuse_count;
+            return;
+        }
+        labor_cache.item_scan_countdown = ITEM_SCAN_INTERVAL;
+
         priority_food = 0;
+        int refuse_count = 0;
 
         df::item_flags bad_flags;
         bad_flags.whole = 0;
@@ -1149,8 +1306,8 @@ private:
         {
             df::item* item = *i;
 
-            if (item->flags.bits.dump && !labor_infos[df::unit_labor::HAUL_REFUSE].is_unmanaged())
-                labor_needed[df::unit_labor::HAUL_REFUSE]++;
+            if (item->flags.bits.dump)
+                refuse_count++;
 
             if (item->flags.whole & bad_flags.whole)
                 continue;
@@ -1174,6 +1331,13 @@ private:
                 tool_count[TOOL_CROSSBOW]++;
         }
 
+        if (!labor_infos[df::unit_labor::HAUL_REFUSE].is_unmanaged())
+            labor_needed[df::unit_labor::HAUL_REFUSE] += refuse_count;
+
+        for (int e = TOOL_NONE; e < TOOLS_MAX; e++)
+            labor_cache.tool_count[e] = tool_count[e];
+        labor_cache.priority_food = priority_food;
+        labor_cache.refuse_count = refuse_count;
     }
 
     void collect_job_list()
@@ -1201,6 +1365,15 @@ private:
         state_count.clear();
         state_count.resize(NUM_STATE);
 
+        // mothers of active children, so that the check below is not quadratic
+        std::unordered_set<int32_t> mothers;
+        for (auto u = world->units.active.begin(); u != world->units.active.end(); ++u)
+        {
+            if (Units::isActive(*u) &&
+                ((*u)->profession == df::profession::CHILD || (*u)->profession == df::profession::BABY))
+                mothers.insert((*u)->relationship_ids[df::unit_relationship_type::Mother]);
+        }
+
         for (auto u = world->units.active.begin(); u != world->units.active.end(); ++u)
         {
             df::unit* cre = *u;
@@ -1277,17 +1450,11 @@ private:
 
                 // check to see if dwarf has minor children
 
-                for (auto u2 = world->units.active.begin(); u2 != world->units.active.end(); ++u2)
+                if (mothers.count(dwarf->dwarf->id))
                 {
-                    if ((*u2)->relationship_ids[df::unit_relationship_type::Mother] == dwarf->dwarf->id &&
-                        Units::isActive(*u2) &&
-                        ((*u2)->profession == df::profession::CHILD || (*u2)->profession == df::profession::BABY))
-                    {
-                        dwarf->has_children = true;
-                        if (print_debug)
-                            out.print("Dwarf %s has minor children\n", dwarf->dwarf->name.first_name.c_str());
-                        break;
-                    }
+                    dwarf->has_children = true;
+                    if (print_debug)
+                        out.print("Dwarf %s has minor children\n", dwarf->dwarf->name.first_name.c_str());
                 }
 
                 // check if dwarf has an axe, pick, or crossbow
@@ -1608,7 +1775,7 @@ public:
             cnt_setting = cnt_traction = cnt_crutch = 0;
         need_food_water = 0;
 
-        labor_needed.clear();
+        std::fill(labor_needed, labor_needed + NUM_LABORS, 0);
 
         for (int e = 0; e < TOOLS_MAX; e++)
             tool_count[e] = 0;
@@ -1797,28 +1964,29 @@ public:
 
         if (print_debug)
         {
-            for (auto i = labor_needed.begin(); i != labor_needed.end(); i++)
+            FOR_ENUM_ITEMS(unit_labor, l)
             {
-                out.print("labor_needed [%s] = %d, busy = %d, outside = %d, idle = %d\n", ENUM_KEY_STR(unit_labor, i->first).c_str(), i->second,
-                    labor_infos[i->first].busy_dwarfs, labor_outside[i->first], labor_infos[i->first].idle_dwarfs);
+                if (l == df::unit_labor::NONE)
+                    continue;
+                out.print("labor_needed [%s] = %d, busy = %d, outside = %d, idle = %d\n", ENUM_KEY_STR(unit_labor, l).c_str(), labor_needed[l],
+                    labor_infos[l].busy_dwarfs, labor_outside[l], labor_infos[l].idle_dwarfs);
             }
         }
 
-        std::map<df::unit_labor, int> base_priority;
+        int base_priority[NUM_LABORS] = { 0 };
         priority_queue<pair<int, df::unit_labor>> pq;
         priority_queue<pair<int, df::unit_labor>> pq2;
 
-        for (auto i = labor_needed.begin(); i != labor_needed.end(); i++)
+        FOR_ENUM_ITEMS(unit_labor, l)
         {
-            df::unit_labor l = i->first;
             if (l == df::unit_labor::NONE || labor_infos[l].is_unmanaged())
                 continue;
 
             const int user_specified_max_dwarfs = labor_infos[l].maximum_dwarfs();
 
-            if (user_specified_max_dwarfs != MAX_DWARFS_NONE && i->second > user_specified_max_dwarfs)
+            if (user_specified_max_dwarfs != MAX_DWARFS_NONE && labor_needed[l] > user_specified_max_dwarfs)
             {
-                i->second = user_specified_max_dwarfs;
+                labor_needed[l] = user_specified_max_dwarfs;
             }
 
             int priority = labor_infos[l].priority();
@@ -1828,7 +1996,7 @@ public:
 
             base_priority[l] = priority;
 
-            if (i->second > 0)
+            if (labor_needed[l] > 0)
             {
                 pq.push(make_pair(priority, l));
             }
@@ -1837,9 +2005,7 @@ public:
         if (print_debug)
             out.print("available count = %zu, distinct labors needed = %zu\n", available_dwarfs.size(), pq.size());
 
-        std::map<df::unit_labor, int> to_assign;
-
-        to_assign.clear();
+        int to_assign[NUM_LABORS] = { 0 };
 
         size_t av = available_dwarfs.size();
 
@@ -1890,13 +2056,11 @@ public:
             int best_score = INT_MIN;
             df::unit_labor best_labor = df::unit_labor::NONE;
 
-            for (auto j = to_assign.begin(); j != to_assign.end(); j++)
+            FOR_ENUM_ITEMS(unit_labor, labor)
             {
-                if (j->second <= 0)
+                if (labor == df::unit_labor::NONE || to_assign[labor] <= 0)
                     continue;
 
-                df::unit_labor labor = j->first;
-
                 for (std::list<dwarf_info_t*>::iterator k = available_dwarfs.begin(); k != available_dwarfs.end(); k++)
                 {
                     dwarf_info_t* d = (*k);
@@ -2165,6 +2329,7 @@ public:
         {
             *df::global::process_dig = true;
             *df::global::process_jobs = true;
+            labor_cache.own_process_dig = true;
         }
 
         if (print_debug) {
@@ -2208,6 +2373,13 @@ DFhackCExport command_result plugin_onupdate(color_ostream &out)
     //    if (++step_count < 60)
     //        return CR_OK;
 
+    // DF sets process_dig when designations are added or removed, so count
+    // them all again (unless it was set by the previous cycle)
+    if (!*df::global::process_dig)
+        labor_cache.own_process_dig = false;
+    else if (!labor_cache.own_process_dig)
+        labor_cache.rescan_designations = true;
+
     if (*df::global::process_jobs)
         return CR_OK;
 
@@ -10,7 +10,9 @@
 #include <iomanip>
 #include <map>
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -75,6 +77,15 @@ struct matdata
         }
         return count;
     }
+    void merge(const matdata &other)
+    {
+        count += other.count;
+        if(other.lower_z != invalid_z)
+        {
+            add(other.lower_z, 0);
+            add(other.upper_z, 0);
+        }
+    }
     unsigned int count;
     int lower_z;
     int upper_z;
@@ -102,6 +113,12 @@ typedef std::vector< pair<int16_t, matdata> > MatSorter;
 
 typedef std::vector<df::plant *> PlantList;
 
+static void mergeMats(MatMap &into, const MatMap &from)
+{
+    for (const auto &kv : from)
+        into[kv.first].merge(kv.second);
+}
+
 #define TO_PTR_VEC(obj_vec, ptr_vec) \
     ptr_vec.clear(); \
     for (size_t i = 0; i < obj_vec.size(); i++) \
@@ -227,8 +244,18 @@ DFhackCExport command_result plugin_init ( color_ostream &out, std::vector <Plug
     return CR_OK;
 }
 
+static void clear_embark_estimates();
+
 DFhackCExport command_result plugin_shutdown ( color_ostream &out )
 {
+    clear_embark_estimates();
+    return CR_OK;
+}
+
+DFhackCExport command_result plugin_onstatechange(color_ostream &out, state_change_event event)
+{
+    if (event == SC_WORLD_UNLOADED)
+        clear_embark_estimates();
     return CR_OK;
 }
 
@@ -490,6 +517,48 @@ bool estimate_materials(color_ostream &out, EmbarkTileLayout &tile, MatMap &laye
     return true;
 }
 
+// Estimates only depend on the world geology, so they are kept per embark
+// tile while the world stays loaded, and moving the embark rectangle around
+// only has to estimate the tiles that weren't covered yet.
+struct EmbarkTileEstimate {
+    MatMap layerMats;
+    MatMap veinMats;
+    int base_z, elevation;
+};
+
+static df::world_data *estimates_world = NULL;
+static std::map<std::pair<coord2d, coord2d>, EmbarkTileEstimate> embark_estimates;
+
+static void clear_embark_estimates()
+{
+    estimates_world = NULL;
+    embark_estimates.clear();
+}
+
+static EmbarkTileEstimate *get_embark_estimate(color_ostream &out, df::world_region_details *details, int x, int y)
+{
+    if (estimates_world != world->world_data)
+    {
+        clear_embark_estimates();
+        estimates_world = world->world_data;
+    }
+
+    auto key = std::make_pair(details->pos, coord2d(x, y));
+    auto it = embark_estimates.find(key);
+    if (it != embark_estimates.end())
+        return &it->second;
+
+    EmbarkTileLayout tile;
+    EmbarkTileEstimate estimate;
+    if (!estimate_underground(out, tile, details, x, y) ||
+        !estimate_materials(out, tile, estimate.layerMats, estimate.veinMats))
+        return NULL;
+
+    estimate.base_z = tile.base_z;
+    estimate.elevation = tile.elevation;
+    return &(embark_estimates[key] = estimate);
+}
+
 static command_result embark_prospector(color_ostream &out, df::viewscreen_choose_start_sitest *screen,
                                         bool showHidden, bool showValue)
 {
@@ -527,13 +596,15 @@ static command_result embark_prospector(color_ostream &out, df::viewscreen_choos
     {
         for (int y = screen->location.embark_pos_min.y; y <= 15 && y <= screen->location.embark_pos_max.y; y++)
         {
-            EmbarkTileLayout tile;
-            if (!estimate_underground(out, tile, cur_details, x, y) ||
-                !estimate_materials(out, tile, layerMats, veinMats))
+            auto estimate = get_embark_estimate(out, cur_details, x, y);
+            if (!estimate)
                 return CR_FAILURE;
 
-            world_bottom.add(tile.base_z, 0);
-            world_bottom.add(tile.elevation-1, 0);
+            mergeMats(layerMats, estimate->layerMats);
+            mergeMats(veinMats, estimate->veinMats);
+
+            world_bottom.add(estimate->base_z, 0);
+            world_bottom.add(estimate->elevation-1, 0);
         }
     }
 
@@ -555,55 +626,8 @@ static command_result embark_prospector(color_ostream &out, df::viewscreen_choos
     return CR_OK;
 }
 
-command_result prospector (color_ostream &con, vector <string> & parameters)
+struct MapScanResults
 {
-    bool showHidden = false;
-    bool showPlants = true;
-    bool showSlade = true;
-    bool showTemple = true;
-    bool showValue = false;
-    bool showTube = false;
-
-    for(size_t i = 0; i < parameters.size();i++)
-    {
-        if (parameters[i] == "all")
-        {
-            showHidden = true;
-        }
-        else if (parameters[i] == "value")
-        {
-            showValue = true;
-        }
-        else if (parameters[i] == "hell")
-        {
-            showHidden = showTube = true;
-        }
-        else
-            return CR_WRONG_USAGE;
-    }
-
-    CoreSuspender suspend;
-
-    // Embark screen active: estimate using world geology data
-    auto screen = Gui::getViewscreenByType<df::viewscreen_choose_start_sitest>(0);
-    if (screen)
-        return embark_prospector(con, screen, showHidden, showValue);
-
-    if (!Maps::IsValid())
-    {
-        con.printerr("Map is not available!\n");
-        return CR_FAILURE;
-    }
-
-    uint32_t x_max = 0, y_max = 0, z_max = 0;
-    Maps::getSize(x_max, y_max, z_max);
-    MapExtras::MapCache map;
-
-    DFHack::Materials *mats = Core::getInstance().getMaterials();
-
-    DFHack::t_feature blockFeatureGlobal;
-    DFHack::t_feature blockFeatureLocal;
-
     bool hasAquifer = false;
     bool hasDemonTemple = false;
     bool hasLair = false;
@@ -618,226 +642,315 @@ command_result prospector (color_ostream &con, vector <string> & parameters)
     matdata aquiferTiles;
     matdata tubeTiles;
 
-    uint32_t vegCount = 0;
+    void merge(const MapScanResults &other)
+    {
+        hasAquifer = hasAquifer || other.hasAquifer;
+        hasDemonTemple = hasDemonTemple || other.hasDemonTemple;
+        hasLair = hasLair || other.hasLair;
+        mergeMats(baseMats, other.baseMats);
+        mergeMats(layerMats, other.layerMats);
+        mergeMats(veinMats, other.veinMats);
+        mergeMats(plantMats, other.plantMats);
+        mergeMats(treeMats, other.treeMats);
+        liquidWater.merge(other.liquidWater);
+        liquidMagma.merge(other.liquidMagma);
+        aquiferTiles.merge(other.aquiferTiles);
+        tubeTiles.merge(other.tubeTiles);
+    }
+};
+
+// Only reads the map, so separate z levels can be scanned by separate threads,
+// each with its own MapCache and results.
+static void scanZLevel(MapExtras::MapCache &map, uint32_t z, uint32_t x_max, uint32_t y_max,
+                       bool showHidden, bool showPlants, bool showSlade, bool showTemple,
+                       MapScanResults &res)
+{
+    DFHack::t_feature blockFeatureGlobal;
+    DFHack::t_feature blockFeatureLocal;
 
-    for(uint32_t z = 0; z < z_max; z++)
+    for(uint32_t b_y = 0; b_y < y_max; b_y++)
     {
-        for(uint32_t b_y = 0; b_y < y_max; b_y++)
+        for(uint32_t b_x = 0; b_x < x_max; b_x++)
         {
-            for(uint32_t b_x = 0; b_x < x_max; b_x++)
+            // Get the map block
+            df::coord2d blockCoord(b_x, b_y);
+            MapExtras::Block *b = map.BlockAt(DFHack::DFCoord(b_x, b_y, z));
+            if (!b || !b->is_valid())
             {
-                // Get the map block
-                df::coord2d blockCoord(b_x, b_y);
-                MapExtras::Block *b = map.BlockAt(DFHack::DFCoord(b_x, b_y, z));
-                if (!b || !b->is_valid())
-                {
-                    continue;
-                }
+                continue;
+            }
 
-                // Find features
-                b->GetGlobalFeature(&blockFeatureGlobal);
-                b->GetLocalFeature(&blockFeatureLocal);
+            // Find features
+            b->GetGlobalFeature(&blockFeatureGlobal);
+            b->GetLocalFeature(&blockFeatureLocal);
 
-                int global_z = world->map.region_z + z;
+            int global_z = world->map.region_z + z;
 
-                // Iterate over all the tiles in the block
-                for(uint32_t y = 0; y < 16; y++)
+            // Iterate over all the tiles in the block
+            for(uint32_t y = 0; y < 16; y++)
+            {
+                for(uint32_t x = 0; x < 16; x++)
                 {
-                    for(uint32_t x = 0; x < 16; x++)
-                    {
-                        df::coord2d coord(x, y);
-                        df::tile_designation des = b->DesignationAt(coord);
-                        df::tile_occupancy occ = b->OccupancyAt(coord);
+                    df::coord2d coord(x, y);
+                    df::tile_designation des = b->DesignationAt(coord);
+                    df::tile_occupancy occ = b->OccupancyAt(coord);
 
-                        // Skip hidden tiles
-                        if (!showHidden && des.bits.hidden)
-                        {
-                            continue;
-                        }
+                    // Skip hidden tiles
+                    if (!showHidden && des.bits.hidden)
+                    {
+                        continue;
+                    }
 
-                        // Check for aquifer
-                        if (des.bits.water_table)
-                        {
-                            hasAquifer = true;
-                            aquiferTiles.add(global_z);
-                        }
+                    // Check for aquifer
+                    if (des.bits.water_table)
+                    {
+                        res.hasAquifer = true;
+                        res.aquiferTiles.add(global_z);
+                    }
 
-                        // Check for lairs
-                        if (occ.bits.monster_lair)
-                        {
-                            hasLair = true;
-                        }
+                    // Check for lairs
+                    if (occ.bits.monster_lair)
+                    {
+                        res.hasLair = true;
+                    }
 
-                        // Check for liquid
-                        if (des.bits.flow_size)
-                        {
-                            if (des.bits.liquid_type == tile_liquid::Magma)
-                                liquidMagma.add(global_z);
-                            else
-                                liquidWater.add(global_z);
-                        }
+                    // Check for liquid
+                    if (des.bits.flow_size)
+                    {
+                        if (des.bits.liquid_type == tile_liquid::Magma)
+                            res.liquidMagma.add(global_z);
+                        else
+                            res.liquidWater.add(global_z);
+                    }
 
-                        df::tiletype type = b->tiletypeAt(coord);
-                        df::tiletype_shape tileshape = tileShape(type);
-                        df::tiletype_material tilemat = tileMaterial(type);
+                    df::tiletype type = b->tiletypeAt(coord);
+                    df::tiletype_shape tileshape = tileShape(type);
+                    df::tiletype_material tilemat = tileMaterial(type);
 
-                        // We only care about these types
-                        switch (tileshape)
+                    // We only care about these types
+                    switch (tileshape)
+                    {
+                    case tiletype_shape::WALL:
+                    case tiletype_shape::FORTIFICATION:
+                        break;
+                    case tiletype_shape::EMPTY:
+                        /* A heuristic: tubes inside adamantine have EMPTY:AIR tiles which
+                           still have feature_local set. Also check the unrevealed status,
+                           so as to exclude any holes mined by the player. */
+                        if (tilemat == tiletype_material::AIR &&
+                            des.bits.feature_local && des.bits.hidden &&
+                            blockFeatureLocal.type == feature_type::deep_special_tube)
                         {
-                        case tiletype_shape::WALL:
-                        case tiletype_shape::FORTIFICATION:
-                            break;
-                        case tiletype_shape::EMPTY:
-                            /* A heuristic: tubes inside adamantine have EMPTY:AIR tiles which
-                               still have feature_local set. Also check the unrevealed status,
-                               so as to exclude any holes mined by the player. */
-                            if (tilemat == tiletype_material::AIR &&
-                                des.bits.feature_local && des.bits.hidden &&
-                                blockFeatureLocal.type == feature_type::deep_special_tube)
-                            {
-                                tubeTiles.add(global_z);
-                            }
-                        default:
-                            continue;
+                            res.tubeTiles.add(global_z);
                         }
+                    default:
+                        continue;
+                    }
 
-                        // Count the material type
-                        baseMats[tilemat].add(global_z);
+                    // Count the material type
+                    res.baseMats[tilemat].add(global_z);
 
-                        // Find the type of the tile
-                        switch (tilemat)
+                    // Find the type of the tile
+                    switch (tilemat)
+                    {
+                    case tiletype_material::SOIL:
+                    case tiletype_material::STONE:
+                        res.layerMats[b->layerMaterialAt(coord)].add(global_z);
+                        break;
+                    case tiletype_material::MINERAL:
+                        res.veinMats[b->veinMaterialAt(coord)].add(global_z);
+                        break;
+                    case tiletype_material::FEATURE:
+                        if (blockFeatureLocal.type != -1 && des.bits.feature_local)
                         {
-                        case tiletype_material::SOIL:
-                        case tiletype_material::STONE:
-                            layerMats[b->layerMaterialAt(coord)].add(global_z);
-                            break;
-                        case tiletype_material::MINERAL:
-                            veinMats[b->veinMaterialAt(coord)].add(global_z);
-                            break;
-                        case tiletype_material::FEATURE:
-                            if (blockFeatureLocal.type != -1 && des.bits.feature_local)
+                            if (blockFeatureLocal.type == feature_type::deep_special_tube
+                                    && blockFeatureLocal.main_material == 0) // stone
                             {
-                                if (blockFeatureLocal.type == feature_type::deep_special_tube
-                                        && blockFeatureLocal.main_material == 0) // stone
-                                {
-                                    veinMats[blockFeatureLocal.sub_material].add(global_z);
-                                }
-                                else if (showTemple
-                                         && blockFeatureLocal.type == feature_type::deep_surface_portal)
-                                {
-                                    hasDemonTemple = true;
-                                }
+                                res.veinMats[blockFeatureLocal.sub_material].add(global_z);
                             }
-
-                            if (showSlade && blockFeatureGlobal.type != -1 && des.bits.feature_global
-                                    && blockFeatureGlobal.type == feature_type::underworld_from_layer
-                                    && blockFeatureGlobal.main_material == 0) // stone
+                            else if (showTemple
+                                     && blockFeatureLocal.type == feature_type::deep_surface_portal)
                             {
-                                layerMats[blockFeatureGlobal.sub_material].add(global_z);
+                                res.hasDemonTemple = true;
                             }
-                            break;
-                        case tiletype_material::LAVA_STONE:
-                            // TODO ?
-                            break;
-                        default:
-                            break;
                         }
+
+                        if (showSlade && blockFeatureGlobal.type != -1 && des.bits.feature_global
+                                && blockFeatureGlobal.type == feature_type::underworld_from_layer
+                                && blockFeatureGlobal.main_material == 0) // stone
+                        {
+                            res.layerMats[blockFeatureGlobal.sub_material].add(global_z);
+                        }
+                        break;
+                    case tiletype_material::LAVA_STONE:
+                        // TODO ?
+                        break;
+                    default:
+                        break;
                     }
                 }
+            }
 
-                // Check plants this way, as the other way wasn't getting them all
-                // and we can check visibility more easily here
-                if (showPlants)
+            // Check plants this way, as the other way wasn't getting them all
+            // and we can check visibility more easily here
+            if (showPlants)
+            {
+                auto block = Maps::getBlockColumn(b_x,b_y);
+                vector<df::plant *> *plants = block ? &block->plants : NULL;
+                if(plants)
                 {
-                    auto block = Maps::getBlockColumn(b_x,b_y);
-                    vector<df::plant *> *plants = block ? &block->plants : NULL;
-                    if(plants)
+                    for (PlantList::const_iterator it = plants->begin(); it != plants->end(); it++)
                     {
-                        for (PlantList::const_iterator it = plants->begin(); it != plants->end(); it++)
+                        const df::plant & plant = *(*it);
+                        if (uint32_t(plant.pos.z) != z)
+                            continue;
+                        df::coord2d loc(plant.pos.x, plant.pos.y);
+                        loc = loc % 16;
+                        if (showHidden || !b->DesignationAt(loc).bits.hidden)
                         {
-                            const df::plant & plant = *(*it);
-                            if (uint32_t(plant.pos.z) != z)
-                                continue;
-                            df::coord2d loc(plant.pos.x, plant.pos.y);
-                            loc = loc % 16;
-                            if (showHidden || !b->DesignationAt(loc).bits.hidden)
-                            {
-                                if(plant.flags.bits.is_shrub)
-                                    plantMats[plant.material].add(global_z);
-                                else
-                                    treeMats[plant.material].add(global_z);
-                            }
+                            if(plant.flags.bits.is_shrub)
+                                res.plantMats[plant.material].add(global_z);
+                            else
+                                res.treeMats[plant.material].add(global_z);
                         }
                     }
                 }
-                // Block end
-            } // block x
+            }
+            // Block end
+        } // block x
+
+        // Clean uneeded memory
+        map.trash();
+    } // block y
+}
 
-            // Clean uneeded memory
-            map.trash();
-        } // block y
-    } // z
+command_result prospector (color_ostream &con, vector <string> & parameters)
+{
+    bool showHidden = false;
+    bool showPlants = true;
+    bool showSlade = true;
+    bool showTemple = true;
+    bool showValue = false;
+    bool showTube = false;
+
+    for(size_t i = 0; i < parameters.size();i++)
+    {
+        if (parameters[i] == "all")
+        {
+            showHidden = true;
+        }
+        else if (parameters[i] == "value")
+        {
+            showValue = true;
+        }
+        else if (parameters[i] == "hell")
+        {
+            showHidden = showTube = true;
+        }
+        else
+            return CR_WRONG_USAGE;
+    }
+
+    CoreSuspender suspend;
+
+    // Embark screen active: estimate using world geology data
+    auto screen = Gui::getViewscreenByType<df::viewscreen_choose_start_sitest>(0);
+    if (screen)
+        return embark_prospector(con, screen, showHidden, showValue);
+
+    if (!Maps::IsValid())
+    {
+        con.printerr("Map is not available!\n");
+        return CR_FAILURE;
+    }
+
+    uint32_t x_max = 0, y_max = 0, z_max = 0;
+    Maps::getSize(x_max, y_max, z_max);
+
+    DFHack::Materials *mats = Core::getInstance().getMaterials();
+
+    // Hand out z levels to the worker threads, then merge their tallies
+    std::atomic<uint32_t> next_z(0);
+    auto worker = [&](MapScanResults &res)
+    {
+        MapExtras::MapCache map;
+        for (uint32_t z; (z = next_z++) < z_max; )
+            scanZLevel(map, z, x_max, y_max, showHidden, showPlants, showSlade, showTemple, res);
+    };
+
+    size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+    std::vector<MapScanResults> results(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; i++)
+        threads.emplace_back(worker, std::ref(results[i]));
+    worker(results[0]);
+    for (auto &thread : threads)
+        thread.join();
+
+    MapScanResults &res = results[0];
+    for (size_t i = 1; i < thread_count; i++)
+        res.merge(results[i]);
 
     MatMap::const_iterator it;
 
     con << "Base materials:" << std::endl;
-    for (it = baseMats.begin(); it != baseMats.end(); ++it)
+    for (it = res.baseMats.begin(); it != res.baseMats.end(); ++it)
     {
         con << std::setw(25) << ENUM_KEY_STR(tiletype_material,(df::tiletype_material)it->first) << " : " << it->second.count << std::endl;
     }
 
-    if (liquidWater.count || liquidMagma.count)
+    if (res.liquidWater.count || res.liquidMagma.count)
     {
         con << std::endl << "Liquids:" << std::endl;
-        if (liquidWater.count)
+        if (res.liquidWater.count)
         {
             con << std::setw(25) << "WATER" << " : ";
-            printMatdata(con, liquidWater);
+            printMatdata(con, res.liquidWater);
         }
-        if (liquidWater.count)
+        if (res.liquidWater.count)
         {
             con << std::setw(25) << "MAGMA" << " : ";
-            printMatdata(con, liquidMagma);
+            printMatdata(con, res.liquidMagma);
         }
     }
 
     con << std::endl << "Layer materials:" << std::endl;
-    printMats<df::inorganic_raw, shallower>(con, layerMats, world->raws.inorganics, showValue);
+    printMats<df::inorganic_raw, shallower>(con, res.layerMats, world->raws.inorganics, showValue);
 
-    printVeins(con, veinMats, mats, showValue);
+    printVeins(con, res.veinMats, mats, showValue);
 
     if (showPlants)
     {
         con << "Shrubs:" << std::endl;
-        printMats<df::plant_raw, std::greater>(con, plantMats, world->raws.plants.all, showValue);
+        printMats<df::plant_raw, std::greater>(con, res.plantMats, world->raws.plants.all, showValue);
         con << "Wood in trees:" << std::endl;
-        printMats<df::plant_raw, std::greater>(con, treeMats, world->raws.plants.all, showValue);
+        printMats<df::plant_raw, std::greater>(con, res.treeMats, world->raws.plants.all, showValue);
     }
 
-    if (hasAquifer)
+    if (res.hasAquifer)
     {
         con << "Has aquifer";
-        if (aquiferTiles.count)
+        if (res.aquiferTiles.count)
         {
             con << "               : ";
-            printMatdata(con, aquiferTiles);
+            printMatdata(con, res.aquiferTiles);
         }
         else
             con << std::endl;
     }
 
-    if (showTube && tubeTiles.count)
+    if (showTube && res.tubeTiles.count)
     {
         con << "Has HFS tubes             : ";
-        printMatdata(con, tubeTiles);
+        printMatdata(con, res.tubeTiles);
     }
 
-    if (hasDemonTemple)
+    if (res.hasDemonTemple)
     {
         con << "Has demon temple" << std::endl;
     }
 
-    if (hasLair)
+    if (res.hasLair)
     {
         con << "Has lair" << std::endl;
     }
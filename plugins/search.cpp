@@ -330,6 +330,7 @@ protected:
         end_entry_mode();
         search_string = "";
         saved_list1.clear();
+        clear_search_index();
     }
 
     // Shortcut to clear the search immediately
@@ -341,6 +342,26 @@ protected:
             saved_list1.clear();
         }
         search_string = "";
+        clear_search_index();
+    }
+
+    // Lowercased descriptions of the saved list, generated once per list
+    // instead of on every keystroke
+    void build_search_index()
+    {
+        search_index.resize(saved_list1.size());
+        for (size_t i = 0; i < saved_list1.size(); i++)
+            search_index[i] = toLower(get_element_description(saved_list1[i]));
+
+        search_matches.assign(saved_list1.size(), MATCH_UNKNOWN);
+        last_search_string_l.clear();
+    }
+
+    void clear_search_index()
+    {
+        search_index.clear();
+        search_matches.clear();
+        last_search_string_l.clear();
     }
 
     virtual void save_original_values()
@@ -388,33 +409,51 @@ protected:
         }
 
         if (saved_list1.size() == 0)
+        {
             // On first run, save the original list
             save_original_values();
+            build_search_index();
+        }
         else
             do_pre_incremental_search();
 
         clear_viewscreen_vectors();
 
+        // If the query only got longer, anything that didn't match before
+        // can't match now
         string search_string_l = toLower(search_string);
+        bool narrowing = !last_search_string_l.empty() &&
+            search_string_l.compare(0, last_search_string_l.size(), last_search_string_l) == 0;
+
         for (size_t i = 0; i < saved_list1.size(); i++ )
         {
             if (force_in_search(i))
             {
+                search_matches[i] = MATCH_UNKNOWN;
                 add_to_filtered_list(i);
                 continue;
             }
 
             if (!is_valid_for_search(i))
+            {
+                search_matches[i] = MATCH_UNKNOWN;
+                continue;
+            }
+
+            if (narrowing && search_matches[i] == MATCH_NO)
                 continue;
 
-            T element = saved_list1[i];
-            string desc = toLower(get_element_description(element));
-            if (desc.find(search_string_l) != string::npos)
+            if (search_index[i].find(search_string_l) != string::npos)
             {
+                search_matches[i] = MATCH_YES;
                 add_to_filtered_list(i);
             }
+            else
+                search_matches[i] = MATCH_NO;
         }
 
+        last_search_string_l = search_string_l;
+
         do_post_search();
 
         if (cursor_pos)
@@ -444,6 +483,11 @@ protected:
     S *viewscreen;
     vector <T> saved_list1, reference_list, *primary_list;
 
+    enum match_state : uint8_t { MATCH_UNKNOWN, MATCH_YES, MATCH_NO };
+    vector<string> search_index;
+    vector<match_state> search_matches;
+    string last_search_string_l;
+
     //bool redo_search;
     string search_string;
 
@@ -2,6 +2,7 @@
 #include "listcolumn.h"
 
 #include <functional>
+#include <unordered_map>
 
 // DF data structure definition headers
 #include "DataDefs.h"
@@ -246,7 +247,7 @@ static string get_keywords(df::item *item)
     return keywords;
 }
 
-static string get_item_label(df::item *item, bool trim = false)
+static string make_item_label(df::item *item, bool trim)
 {
     auto label = Items::getDescription(item, 0, false);
     if (trim && item->getType() == item_type::BIN)
@@ -290,6 +291,87 @@ static string get_item_label(df::item *item, bool trim = false)
     return label;
 }
 
+static int32_t count_contained_items(df::item *item)
+{
+    int32_t count = 0;
+    for (auto ref : item->general_refs)
+    {
+        if (ref->getType() == general_ref_type::CONTAINS_ITEM)
+            count++;
+    }
+    return count;
+}
+
+/*
+ * Generating item descriptions is the slowest part of listing stocks, so
+ * labels are kept across refreshes and screen openings, keyed by item id.
+ * A cached label is reused as long as everything that goes into it is
+ * unchanged. That includes the number of items inside, as the untrimmed
+ * label of bins, barrels, bags and other containers shows it.
+ */
+struct item_label_entry
+{
+    df::item *item;
+    df::item_type type;
+    int16_t subtype, mat_type, quality, wear;
+    int32_t mat_index, stack_size, contents;
+    bool improved;
+    string label, trimmed_label;
+
+    bool matches(df::item *item) const
+    {
+        return this->item == item &&
+            type == item->getType() &&
+            subtype == item->getSubtype() &&
+            mat_type == item->getMaterial() &&
+            mat_index == item->getMaterialIndex() &&
+            quality == item->getQuality() &&
+            wear == item->getWear() &&
+            stack_size == item->getStackSize() &&
+            contents == count_contained_items(item) &&
+            improved == item->hasImprovements();
+    }
+};
+
+static std::unordered_map<int32_t, item_label_entry> item_labels;
+
+static string get_item_label(df::item *item, bool trim = false)
+{
+    auto &entry = item_labels[item->id];
+    if (!entry.matches(item))
+    {
+        entry.item = item;
+        entry.type = item->getType();
+        entry.subtype = item->getSubtype();
+        entry.mat_type = item->getMaterial();
+        entry.mat_index = item->getMaterialIndex();
+        entry.quality = item->getQuality();
+        entry.wear = item->getWear();
+        entry.stack_size = item->getStackSize();
+        entry.contents = count_contained_items(item);
+        entry.improved = item->hasImprovements();
+        entry.label.clear();
+        entry.trimmed_label.clear();
+    }
+
+    string &label = trim ? entry.trimmed_label : entry.label;
+    if (label.empty())
+        label = make_item_label(item, trim);
+
+    return label;
+}
+
+static void prune_item_labels()
+{
+    for (auto it = item_labels.begin(); it != item_labels.end();)
+    {
+        if (df::item::find(it->first) != it->second.item)
+            it = item_labels.erase(it);
+        else
+            ++it;
+    }
+}
+
 struct item_grouped_entry
 {
     std::vector<df::item *> entries;
@@ -373,7 +455,7 @@ struct extra_filters
 };
 
 static bool cages_populated = false;
-static vector<df::building_cagest *> cages;
+static std::unordered_map<int32_t, df::building_cagest *> cages;
 
 static void find_cages()
 {
@@ -385,7 +467,9 @@ static void find_cages()
         df::building* building = world->buildings.all[b];
         if (building->getType() == building_type::Cage)
         {
-            cages.push_back(static_cast<df::building_cagest *>(building));
+            auto cage = static_cast<df::building_cagest *>(building);
+            for (size_t c = 0; c < cage->assigned_units.size(); c++)
+                cages.emplace(cage->assigned_units[c], cage);
         }
     }
 
@@ -395,15 +479,9 @@ static void find_cages()
 static df::building_cagest *is_in_cage(df::unit *unit)
 {
     find_cages();
-    for (auto it = cages.begin(); it != cages.end(); it++)
-    {
-        auto cage = *it;
-        for (size_t c = 0; c < cage->assigned_units.size(); c++)
-        {
-            if(cage->assigned_units[c] == unit->id)
-                return cage;
-        }
-    }
+    auto it = cages.find(unit->id);
+    if (it != cages.end())
+        return it->second;
 
     return nullptr;
 }
@@ -652,6 +730,7 @@ public:
         cages.clear();
         items_in_cages.clear();
         cages_populated = false;
+        prune_item_labels();
 
         last_selected_item = nullptr;
 
@@ -665,6 +744,7 @@ public:
         hide_flags.whole = 0;
         extra_hide_flags.reset();
         depot_info.reset();
+        item_labels.clear();
     }
 
     void feed(set<df::interface_key> *input)
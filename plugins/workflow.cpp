@@ -1182,6 +1182,29 @@ static void map_job_items(color_ostream &out)
 
     bool dry_buckets = isOptionEnabled(CF_DRYBUCKETS);
 
+    // Bucket the constraints by item type, so that each item is only
+    // tested against the few constraints that can match it. Craft
+    // constraints go into the bucket of every craft item type.
+    static std::vector<std::vector<ItemConstraint*> > by_type;
+    by_type.resize(ENUM_LAST_ITEM(item_type) + 1);
+    for (auto &bucket : by_type)
+        bucket.clear();
+
+    for (size_t i = 0; i < constraints.size(); i++)
+    {
+        ItemConstraint *cv = constraints[i];
+        if (cv->is_craft)
+        {
+            FOR_ENUM_ITEMS(item_type, type)
+            {
+                if (type != item_type::NONE && isCraftItem(type))
+                    by_type[type].push_back(cv);
+            }
+        }
+        else if (cv->item.type >= 0 && size_t(cv->item.type) < by_type.size())
+            by_type[cv->item.type].push_back(cv);
+    }
+
     std::vector<df::item*> &items = world->items.other[items_other_id::IN_PLAY];
 
     for (size_t i = 0; i < items.size(); i++)
@@ -1192,6 +1215,17 @@ static void map_job_items(color_ostream &out)
             continue;
 
         df::item_type itype = item->getType();
+
+        if (itype == item_type::BUCKET && dry_buckets && !item->flags.bits.in_job)
+            dryBucket(item);
+
+        if (item->flags.bits.melt && !item->flags.bits.owned && !itemBusy(item))
+            meltable_count++;
+
+        if (itype < 0 || size_t(itype) >= by_type.size() || by_type[itype].empty())
+            continue;
+        auto &bucket = by_type[itype];
+
         int16_t isubtype = item->getSubtype();
         int16_t imattype = item->getActualMaterial();
         int32_t imatindex = item->getActualMaterialIndex();
@@ -1204,11 +1238,6 @@ static void map_job_items(color_ostream &out)
 
         // Special handling
         switch (itype) {
-        case item_type::BUCKET:
-            if (dry_buckets && !item->flags.bits.in_job)
-                dryBucket(item);
-            break;
-
         case item_type::THREAD:
             if (item->flags.bits.spider_web)
                 continue;
@@ -1225,27 +1254,15 @@ static void map_job_items(color_ostream &out)
             break;
         }
 
-        if (item->flags.bits.melt && !item->flags.bits.owned && !itemBusy(item))
-            meltable_count++;
-
         // Match to constraints
         TMaterialCache::key_type matkey(imattype, imatindex);
 
-        for (size_t i = 0; i < constraints.size(); i++)
+        for (size_t i = 0; i < bucket.size(); i++)
         {
-            ItemConstraint *cv = constraints[i];
+            ItemConstraint *cv = bucket[i];
 
-            if (cv->is_craft)
-            {
-                if (!isCraftItem(itype))
-                    continue;
-            }
-            else
-            {
-                if (cv->item.type != itype ||
-                    (cv->item.subtype != -1 && cv->item.subtype != isubtype))
-                    continue;
-            }
+            if (!cv->is_craft && cv->item.subtype != -1 && cv->item.subtype != isubtype)
+                continue;
 
             if (cv->is_local && item->flags.bits.foreign)
                 continue;
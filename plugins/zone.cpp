@@ -30,6 +30,7 @@
 #include <climits>
 #include <vector>
 #include <algorithm>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
@@ -770,21 +771,34 @@ bool isEmptyPasture(df::building* building)
         return false;
 }
 
-df::building* findFreeNestboxZone()
+// collect all empty pastures which have a free nestbox at their top left corner
+// (looks up the nestboxes once instead of scanning all buildings for each zone)
+void findFreeNestboxZones(vector<df::building*> &zones)
 {
-    df::building * free_building = NULL;
+    std::set<df::coord> free_nestboxes;
+    for (size_t b=0; b < world->buildings.all.size(); b++)
+    {
+        df::building* building = world->buildings.all[b];
+        if(building->getType() != building_type::NestBox)
+            continue;
+        df::building_nest_boxst* nestbox = (df::building_nest_boxst*) building;
+        if(nestbox->claimed_by == -1 && nestbox->contained_items.size() == 1)
+            free_nestboxes.insert(df::coord(building->x1, building->y1, building->z));
+    }
+
+    if(free_nestboxes.empty())
+        return;
+
     for (size_t b=0; b < world->buildings.all.size(); b++)
     {
         df::building* building = world->buildings.all[b];
         if( isEmptyPasture(building) &&
             isActive(building) &&
-            isFreeNestboxAtPos(building->x1, building->y1, building->z))
+            free_nestboxes.count(df::coord(building->x1, building->y1, building->z)))
         {
-            free_building = building;
-            break;
+            zones.push_back(building);
         }
     }
-    return free_building;
 }
 
 bool isFreeEgglayer(df::unit * unit)
@@ -800,31 +814,14 @@ bool isFreeEgglayer(df::unit * unit)
         && !isForest(unit);  // don't steal birds from traders, they hate that
 }
 
-df::unit * findFreeEgglayer()
+void findFreeEgglayers(vector<df::unit*> &units)
 {
-    df::unit* free_unit = NULL;
     for (size_t i=0; i < world->units.all.size(); i++)
     {
         df::unit* unit = world->units.all[i];
         if(isFreeEgglayer(unit))
-        {
-            free_unit = unit;
-            break;
-        }
-    }
-    return free_unit;
-}
-
-size_t countFreeEgglayers()
-{
-    size_t count = 0;
-    for (size_t i=0; i < world->units.all.size(); i++)
-    {
-        df::unit* unit = world->units.all[i];
-        if(isFreeEgglayer(unit))
-            count ++;
+            units.push_back(unit);
     }
-    return count;
 }
 
 // check if unit is already assigned to a zone, remove that ref from unit and old zone
@@ -2297,10 +2294,18 @@ command_result autoNestbox( color_ostream &out, bool verbose = false )
         return CR_FAILURE;
     }
 
+    // an assigned zone is no longer empty and an assigned unit no longer free,
+    // so both lists can be collected once and paired up in order
+    vector<df::building*> free_buildings;
+    vector<df::unit*> free_units;
+    findFreeEgglayers(free_units);
+    if(!free_units.empty())
+        findFreeNestboxZones(free_buildings);
+
     do
     {
-        df::building * free_building = findFreeNestboxZone();
-        df::unit * free_unit = findFreeEgglayer();
+        df::building * free_building = processed < free_buildings.size() ? free_buildings[processed] : NULL;
+        df::unit * free_unit = processed < free_units.size() ? free_units[processed] : NULL;
         if(free_building && free_unit)
         {
             command_result result = assignUnitToBuilding(out, free_unit, free_building, verbose);
@@ -2314,7 +2319,7 @@ command_result autoNestbox( color_ostream &out, bool verbose = false )
             if(free_unit && !free_building)
             {
                 static size_t old_count = 0;
-                size_t freeEgglayers = countFreeEgglayers();
+                size_t freeEgglayers = free_units.size() - processed;
                 // avoid spamming the same message
                 if(old_count != freeEgglayers)
                     autonestbox_did_complain = false;
@@ -2352,27 +2357,33 @@ command_result autoNestbox( color_ostream &out, bool verbose = false )
 
 // getUnitAge() returns 0 if born in current year, therefore the look at birth_time in that case
 // (assuming that the value from there indicates in which tick of the current year the unit was born)
-bool compareUnitAgesYounger(df::unit* i, df::unit* j)
+// the key is computed once per unit since getAge() is too expensive to call on every comparison
+typedef std::pair<int32_t, int32_t> unit_age_key;
+
+unit_age_key getUnitAgeKey(df::unit* unit)
 {
-    int32_t age_i = (int32_t) getAge(i, true);
-    int32_t age_j = (int32_t) getAge(j, true);
-    if(age_i == 0 && age_j == 0)
-    {
-        age_i = i->birth_time;
-        age_j = j->birth_time;
-    }
-    return (age_i < age_j);
+    int32_t age = (int32_t) getAge(unit, true);
+    return unit_age_key(age, age == 0 ? unit->birth_time : 0);
 }
-bool compareUnitAgesOlder(df::unit* i, df::unit* j)
+
+void sortUnitsByAge(vector<df::unit*> &units, bool older_first)
 {
-    int32_t age_i = (int32_t) getAge(i, true);
-    int32_t age_j = (int32_t) getAge(j, true);
-    if(age_i == 0 && age_j == 0)
-    {
-        age_i = i->birth_time;
-        age_j = j->birth_time;
-    }
-    return (age_i > age_j);
+    if(units.size() < 2)
+        return;
+
+    typedef std::pair<unit_age_key, df::unit*> keyed_unit;
+    vector<keyed_unit> keyed;
+    keyed.reserve(units.size());
+    for(size_t i=0; i<units.size(); i++)
+        keyed.push_back(make_pair(getUnitAgeKey(units[i]), units[i]));
+
+    if(older_first)
+        sort(keyed.begin(), keyed.end(), [](const keyed_unit &i, const keyed_unit &j) { return i.first > j.first; });
+    else
+        sort(keyed.begin(), keyed.end(), [](const keyed_unit &i, const keyed_unit &j) { return i.first < j.first; });
+
+    for(size_t i=0; i<units.size(); i++)
+        units[i] = keyed[i].second;
 }
 
 
@@ -2468,14 +2479,14 @@ public:
 
     void SortUnitsByAge()
     {
-        sort(unit_ptr[fk_index].begin(), unit_ptr[fk_index].end(), compareUnitAgesOlder);
-        sort(unit_ptr[mk_index].begin(), unit_ptr[mk_index].end(), compareUnitAgesOlder);
-        sort(unit_ptr[fa_index].begin(), unit_ptr[fa_index].end(), compareUnitAgesYounger);
-        sort(unit_ptr[ma_index].begin(), unit_ptr[ma_index].end(), compareUnitAgesYounger);
-        sort(prot_ptr[fk_index].begin(), prot_ptr[fk_index].end(), compareUnitAgesOlder);
-        sort(prot_ptr[mk_index].begin(), prot_ptr[mk_index].end(), compareUnitAgesOlder);
-        sort(prot_ptr[fa_index].begin(), prot_ptr[fa_index].end(), compareUnitAgesYounger);
-        sort(prot_ptr[ma_index].begin(), prot_ptr[ma_index].end(), compareUnitAgesYounger);
+        sortUnitsByAge(unit_ptr[fk_index], true);
+        sortUnitsByAge(unit_ptr[mk_index], true);
+        sortUnitsByAge(unit_ptr[fa_index], false);
+        sortUnitsByAge(unit_ptr[ma_index], false);
+        sortUnitsByAge(prot_ptr[fk_index], true);
+        sortUnitsByAge(prot_ptr[mk_index], true);
+        sortUnitsByAge(prot_ptr[fa_index], false);
+        sortUnitsByAge(prot_ptr[ma_index], false);
     }
 
     void PushUnit(df::unit * unit)
@@ -3019,9 +3030,26 @@ command_result autoButcher( color_ostream &out, bool verbose = false )
             return CR_OK;
     }
 
-    for(size_t i=0; i<world->units.all.size(); i++)
+    // look up watched races by id instead of searching the watchlist for every unit
+    unordered_map<int, WatchedRace*> races_by_id;
+    for(size_t i=0; i<watched_races.size(); i++)
+        races_by_id[watched_races[i]->raceId] = watched_races[i];
+
+    // units assigned to built cages defined as rooms, see isInBuiltCageRoom()
+    unordered_set<int32_t> units_in_cage_rooms;
+    for (size_t b=0; b < world->buildings.all.size(); b++)
     {
-        df::unit * unit = world->units.all[i];
+        df::building* building = world->buildings.all[b];
+        if(!building->is_room || building->getType() != building_type::Cage)
+            continue;
+        df::building_cagest* cage = (df::building_cagest*) building;
+        units_in_cage_rooms.insert(cage->assigned_units.begin(), cage->assigned_units.end());
+    }
+
+    // inactive units are skipped anyway, so only the units on the map need to be checked
+    for(size_t i=0; i<world->units.active.size(); i++)
+    {
+        df::unit * unit = world->units.active[i];
 
         // this check is now divided into two steps, squeezed autowatch into the middle
         // first one ignores completely inappropriate units (dead, undead, not belonging to the fort, ...)
@@ -3044,16 +3072,17 @@ command_result autoButcher( color_ostream &out, bool verbose = false )
             continue;
 
         WatchedRace * w = NULL;
-        int watched_index = getWatchedIndex(unit->race);
-        if(watched_index != -1)
+        auto race_it = races_by_id.find(unit->race);
+        if(race_it != races_by_id.end())
         {
-            w = watched_races[watched_index];
+            w = race_it->second;
         }
         else if(enable_autobutcher_autowatch)
         {
             w = new WatchedRace(true, unit->race, default_fk, default_mk, default_fa, default_ma);
             w->UpdateConfig(out);
             watched_races.push_back(w);
+            races_by_id[w->raceId] = w;
 
             string announce;
             announce = "New race added to autobutcher watchlist: " + getRaceNamePluralById(w->raceId);
@@ -3070,7 +3099,7 @@ command_result autoButcher( color_ostream &out, bool verbose = false )
                 || isHunter(unit) // ignore hunting dogs etc
                 // ignore creatures in built cages which are defined as rooms to leave zoos alone
                 // (TODO: better solution would be to allow some kind of slaughter cages which you can place near the butcher)
-                || (isContainedInItem(unit) && isInBuiltCageRoom(unit))  // !!! see comments in isBuiltCageRoom()
+                || (isContainedInItem(unit) && units_in_cage_rooms.count(unit->id))  // !!! see comments in isBuiltCageRoom()
                 || isAvailableForAdoption(unit)
                 || unit->name.has_name )
                 w->PushProtectedUnit(unit);
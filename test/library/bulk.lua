@@ -0,0 +1,75 @@
+local function with_temp_unit(fn)
+    local unit = df.new(df.unit)
+    dfhack.with_finalize(
+        function()
+            for _, v in ipairs(unit.inventory) do v:delete() end
+            unit.inventory:resize(0)
+            for _, v in ipairs(unit.general_refs) do v:delete() end
+            unit.general_refs:resize(0)
+            unit:delete()
+        end,
+        fn, unit
+    )
+end
+
+function test.extract_columns()
+    with_temp_unit(function(unit)
+        for i = 1, 3 do
+            unit.inventory:insert('#', {new=true, body_part_id=10+i})
+        end
+
+        local cols, count = dfhack.bulk.extract(unit.inventory, {'body_part_id', 'item', 'item.id'})
+        expect.eq(count, 3, 'element count')
+        expect.eq(#cols.body_part_id, 3, 'column length')
+        for i = 1, 3 do
+            expect.eq(cols.body_part_id[i], unit.inventory[i-1].body_part_id, 'column value')
+        end
+        expect.eq(cols.item[1], nil, 'null pointer leaf')
+        expect.eq(cols['item.id'][1], nil, 'path through null pointer')
+    end)
+end
+
+function test.extract_empty()
+    with_temp_unit(function(unit)
+        local cols, count = dfhack.bulk.extract(unit.inventory, {'body_part_id'})
+        expect.eq(count, 0, 'element count')
+        expect.eq(#cols.body_part_id, 0, 'column length')
+    end)
+end
+
+function test.extract_malformed_path()
+    with_temp_unit(function(unit)
+        unit.inventory:insert('#', {new=true})
+        expect.error(dfhack.bulk.extract, unit.inventory, {'no_such_field'})
+        expect.error(dfhack.bulk.extract, unit.inventory, {'body_part_id.x'})
+        expect.error(dfhack.bulk.extract, unit.inventory, {'item..id'})
+        expect.error(dfhack.bulk.extract, unit.inventory, {42, {}})
+    end)
+end
+
+function test.extract_too_many_paths()
+    with_temp_unit(function(unit)
+        local paths = {}
+        for i = 1, 1000 do paths[i] = 'body_part_id' end
+        local cols, count = dfhack.bulk.extract(unit.inventory, paths)
+        expect.eq(count, 0, 'at the limit')
+
+        table.insert(paths, 'body_part_id')
+        expect.error(dfhack.bulk.extract, unit.inventory, paths)
+    end)
+end
+
+function test.extract_class_subtypes()
+    with_temp_unit(function(unit)
+        unit.general_refs:insert('#', {new=df.general_ref_contains_itemst, item_id=42})
+        unit.general_refs:insert('#', {new=df.general_ref_building_holderst, building_id=7})
+
+        local cols, count = dfhack.bulk.extract(unit.general_refs, {'item_id', 'building_id', 'no_such_field'})
+        expect.eq(count, 2, 'element count')
+        expect.eq(cols.item_id[1], 42, 'field of first subclass')
+        expect.eq(cols.item_id[2], nil, 'field missing from second subclass')
+        expect.eq(cols.building_id[1], nil, 'field missing from first subclass')
+        expect.eq(cols.building_id[2], 7, 'field of second subclass')
+        expect.eq(next(cols.no_such_field), nil, 'field missing from all subclasses')
+    end)
+end